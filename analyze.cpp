@@ -0,0 +1,147 @@
+// Bot analysis run: PlacementBot plays a fixed series of games on every core and
+// reports how many positions had to be searched. With --cache, evaluations are kept
+// in a memory-mapped EvalCache file shared by all threads and by the following runs,
+// so a warm run replaying the same games skips most searches. With --export, every
+// piece locked becomes a training record (see TrainingData.h).
+//
+// Build: g++ -O2 analyze.cpp -o analyze -pthread
+// Usage: ./analyze [options]
+//   --games N      games to play (default 200)
+//   --pieces N     pieces per game at most (default 1000)
+//   --seed S       seed of the first game, game i plays seed S + i (default 1)
+//   --threads N    worker threads (default: every core)
+//   --cache PATH   evaluation cache file, created or reset when needed
+//   --capacity N   cache slots, rounded up to a power of two (default 4194304)
+//   --export PATH  training records of every game, in the columnar format of TrainingData.h
+#include "src/PlacementBot.h"
+#include "src/TrainingData.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+const int WIDTH = 4, HEIGHT = 16, DEPTH = 4;
+
+struct WorkerResult {
+    uint64_t games = 0;
+    uint64_t pieces = 0;
+    uint64_t layers = 0;
+    uint64_t score = 0;
+    uint64_t searches = 0;
+    uint64_t cacheHits = 0;
+    uint64_t candidates = 0;
+};
+
+void worker(std::atomic<int>& nextGame, int games, int maxPieces, unsigned firstSeed, EvalCache* cache,
+            TrainingExporter* exporter, WorkerResult& result) {
+    PlacementBot bot(cache);
+    std::unique_ptr<TrainingRecorder> recorder;
+    if (exporter) {
+        recorder.reset(new TrainingRecorder(*exporter));
+    }
+    int index;
+    while ((index = nextGame.fetch_add(1)) < games) {
+        Game game(WIDTH, HEIGHT, DEPTH, firstSeed + index);
+        if (recorder) recorder->follow(game);
+        int pieces = 0;
+        while (pieces < maxPieces && game.getIsRunning()) {
+            bot.play(game);
+            if (recorder) recorder->observe(game);
+            pieces++;
+        }
+        // A game stopped at maxPieces is exported with the score it reached
+        if (recorder) recorder->finish();
+        result.games++;
+        result.pieces += pieces;
+        result.layers += game.getTotalLinesCleared();
+        result.score += game.getScore();
+    }
+    result.searches = bot.getSearches();
+    result.cacheHits = bot.getCacheHits();
+    result.candidates = bot.getCandidates();
+}
+
+int main(int argc, char** argv) {
+    int games = 200, maxPieces = 1000;
+    unsigned seed = 1;
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::string cachePath;
+    std::string exportPath;
+    uint64_t capacity = 1ull << 22;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            games = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--pieces") == 0 && i + 1 < argc) {
+            maxPieces = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cachePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--capacity") == 0 && i + 1 < argc) {
+            capacity = std::max(1ull, std::strtoull(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--export") == 0 && i + 1 < argc) {
+            exportPath = argv[++i];
+        }
+    }
+
+    std::unique_ptr<EvalCache> cache;
+    if (!cachePath.empty()) {
+        cache.reset(new EvalCache(cachePath, WIDTH, HEIGHT, DEPTH, PlacementBot::HEURISTIC_VERSION, capacity));
+        if (!cache->isOpen()) return 2;
+        std::printf("[Analyze] Cache %s: %s, %llu entries in %llu slots\n", cachePath.c_str(), cache->isWarm() ? "warm" : "new",
+                    (unsigned long long)cache->getEntries(), (unsigned long long)cache->getCapacity());
+    }
+
+    std::unique_ptr<TrainingExporter> exporter;
+    if (!exportPath.empty()) {
+        exporter.reset(new TrainingExporter(exportPath, WIDTH, HEIGHT, DEPTH));
+        if (!exporter->isOpen()) return 2;
+    }
+
+    std::atomic<int> nextGame{0};
+    std::vector<WorkerResult> results(threadCount);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < threadCount; ++t) {
+        threads.emplace_back(worker, std::ref(nextGame), games, maxPieces, seed, cache.get(), exporter.get(), std::ref(results[t]));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    WorkerResult total;
+    for (const WorkerResult& result : results) {
+        total.games += result.games;
+        total.pieces += result.pieces;
+        total.layers += result.layers;
+        total.score += result.score;
+        total.searches += result.searches;
+        total.cacheHits += result.cacheHits;
+        total.candidates += result.candidates;
+    }
+    uint64_t positions = total.searches + total.cacheHits;
+    std::printf("[Analyze] %llu games, %llu pieces, %.1f layers and %.0f points per game, %.2f s (%.0f pieces/s, %u threads)\n",
+                (unsigned long long)total.games, (unsigned long long)total.pieces, static_cast<double>(total.layers) / total.games,
+                static_cast<double>(total.score) / total.games, seconds, total.pieces / seconds, threadCount);
+    std::printf("[Analyze] %llu positions: %llu searched (%llu boards scored), %llu from the cache (%.1f%%)\n",
+                (unsigned long long)positions, (unsigned long long)total.searches, (unsigned long long)total.candidates,
+                (unsigned long long)total.cacheHits, positions ? 100.0 * total.cacheHits / positions : 0.0);
+    if (cache) {
+        std::printf("[Analyze] Cache now holds %llu entries (%.1f%% full)\n", (unsigned long long)cache->getEntries(),
+                    100.0 * cache->getEntries() / cache->getCapacity());
+    }
+    if (exporter) {
+        exporter->finish();
+        exporter->report();
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+// Compares the generic layer removal of Grid with the ones built for each size of
+// TETRIS_BOARD_SIZES, on the same boards.
+//
+// Reports what sparse storage saves on a huge board.
+//
+// Also counts the heap allocations of the simulation side of a frame when built
+// with -DTETRIS_COUNT_ALLOCATIONS.
+//
+// Build: g++ -O2 bench.cpp -o bench -pthread [-DTETRIS_COUNT_ALLOCATIONS]
+// Usage: ./bench [--rounds N]
+#include "src/Grid.h"
+#include "src/DemoPlayer.h"
+#include "src/AllocationCounter.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+volatile uint64_t benchSink = 0;
+
+// Nanoseconds per call of run(), which performs operations calls
+template <typename Run>
+double nanosecondsPerOperation(int rounds, size_t operations, Run run) {
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        run();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds * 1e9 / (static_cast<double>(rounds) * operations);
+}
+
+Tetromino translated(Tetromino tetromino, int x, int y, int z) {
+    glm::vec3 minPos = tetromino.getBlocks()[0].getPosition();
+    for (const Block& block : tetromino.getBlocks()) {
+        glm::vec3 pos = block.getPosition();
+        minPos = glm::vec3(std::min(minPos.x, pos.x), std::min(minPos.y, pos.y), std::min(minPos.z, pos.z));
+    }
+    tetromino.move(glm::vec3(x - minPos.x, y - minPos.y, z - minPos.z));
+    return tetromino;
+}
+
+void benchmarkSize(int width, int height, int depth, int rounds) {
+    std::mt19937 rng(width * 1000 + height);
+    Grid grid(width, height, depth);
+
+    // Roughly half-filled lower part of the board
+    for (int i = 0; i < width * depth * height / 6; ++i) {
+        Tetromino piece = translated(Tetromino(glm::vec3(0, 0, 0), rng() % 7, 1), rng() % width, height - 4, rng() % depth);
+        if (grid.checkCollision(piece)) continue;
+        while (!grid.checkCollision(piece)) {
+            piece.move(glm::vec3(0, -1, 0));
+        }
+        piece.move(glm::vec3(0, 1, 0));
+        grid.placeTetromino(piece);
+    }
+
+    BoardView board = grid.getBoardView();
+    std::vector<uint8_t> colors(board.colors, board.colors + static_cast<size_t>(width) * height * depth);
+    std::vector<uint64_t> rowMasks(board.rowMasks, board.rowMasks + height * depth);
+
+    const GridKernelTable* tables[2] = { &gridKernelTable<0, 0, 0>(), &selectGridKernels(width, height, depth) };
+    double removeLayer[2];
+    for (int k = 0; k < 2; ++k) {
+        const GridKernelTable& kernels = *tables[k];
+        BoardView scratch = { width, height, depth, colors.data(), rowMasks.data() };
+        removeLayer[k] = nanosecondsPerOperation(rounds, height, [&] {
+            for (int y = 0; y < height; ++y) {
+                kernels.removeLayer(scratch, colors.data(), rowMasks.data(), height - 1 - y);
+            }
+            benchSink = benchSink + colors[0];
+        });
+    }
+
+    std::printf("%2dx%2dx%2d  removeLayer %6.2f -> %6.2f ns (x%.2f)\n",
+                width, height, depth, removeLayer[0], removeLayer[1], removeLayer[0] / removeLayer[1]);
+}
+
+// Memory of a huge, mostly empty board after a few hundred drops, against the dense arrays it would need
+void sparseMemory(int width, int height, int depth, int drops) {
+    std::mt19937 rng(7);
+    Grid grid(width, height, depth);
+    for (int i = 0; i < drops; ++i) {
+        Tetromino piece = translated(Tetromino(glm::vec3(0, 0, 0), rng() % 7, 1), rng() % (width - 3), height - 4, rng() % (depth - 3));
+        if (grid.checkCollision(piece)) continue;
+        piece.move(glm::vec3(0, -grid.dropDistance(piece), 0));
+        grid.placeTetromino(piece);
+    }
+    size_t denseBytes = static_cast<size_t>(width) * height * depth + static_cast<size_t>(height) * depth * sizeof(uint64_t);
+    std::printf("%dx%dx%d %s board, %d drops: %.1f KB, dense arrays would take %.1f MB\n",
+                width, height, depth, grid.getKernelName(), drops, grid.memoryBytes() / 1024.0, denseBytes / (1024.0 * 1024.0));
+}
+
+// What a rendered frame asks of the game: one tick of input and update, then the getters the renderers read
+uint64_t simulationAllocations(int ticks, int& steadyTicks) {
+    Game game(4, 16, 4, 42);
+    DemoPlayer player(42);
+    uint64_t allocated = 0;
+    steadyTicks = 0;
+    for (int tick = 0; tick < ticks; ++tick) {
+        if (!game.getIsRunning()) {
+            game.start(); // Rebuilding the board is not a steady-state frame
+            continue;
+        }
+        uint64_t before = allocations::count();
+        player.play(game);
+        game.update(1.0f / 60.0f);
+        benchSink = benchSink + game.getCurrentTetromino().getBlocks().size() + game.getProjectedTetromino().getBlocks().size()
+                  + game.getNextTetromino().getBlocks().size() + game.getGrid().getHeight();
+        if (tick >= 600) {
+            allocated += allocations::count() - before;
+            steadyTicks++;
+        }
+    }
+    return allocated;
+}
+
+int main(int argc, char** argv) {
+    int rounds = 2000;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = std::max(1, std::atoi(argv[++i]));
+        }
+    }
+
+    std::printf("Generic -> sized layer removal, time per call\n");
+#define TETRIS_BENCHMARK_SIZE(w, h, d) benchmarkSize(w, h, d, rounds);
+    TETRIS_BOARD_SIZES(TETRIS_BENCHMARK_SIZE)
+#undef TETRIS_BENCHMARK_SIZE
+
+    sparseMemory(256, 1024, 256, 500);
+
+    if (!allocations::ENABLED) {
+        std::printf("Allocation counts need -DTETRIS_COUNT_ALLOCATIONS\n");
+        return 0;
+    }
+    int steadyTicks = 0;
+    uint64_t allocated = simulationAllocations(100000, steadyTicks);
+    std::printf("Simulation: %llu heap allocations in %d steady-state ticks\n", (unsigned long long)allocated, steadyTicks);
+    return allocated == 0 ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+// Build: g++ -O2 -shared -fPIC capi/tetris3d.cpp -o libtetris3d.so -pthread
+#include "tetris3d.h"
+#include "../src/Environment.h"
+#include <vector>
+
+struct tetris3d_env {
+    int width, height, depth;
+    std::vector<std::unique_ptr<Environment>> environments;
+    tetris3d_buffers buffers{};
+
+    void writeObservation(int index) {
+        const Environment& environment = *environments[index];
+        size_t cells = static_cast<size_t>(width) * height * depth;
+        size_t columns = static_cast<size_t>(width) * depth;
+        if (buffers.occupancy) environment.writeOccupancy(buffers.occupancy + index * cells);
+        if (buffers.heightmap) environment.writeHeightmap(buffers.heightmap + index * columns);
+        if (buffers.piece) environment.writePiece(buffers.piece + index * 12);
+        if (buffers.piece_ids) {
+            buffers.piece_ids[index * 2] = environment.getGame().getCurrentShape();
+            buffers.piece_ids[index * 2 + 1] = environment.getGame().getNextShape();
+        }
+        if (buffers.score) buffers.score[index] = environment.getGame().getScore();
+    }
+
+    void step(int index, int32_t action) {
+        bool done = false;
+        float reward = environments[index]->step(action, done);
+        if (buffers.reward) buffers.reward[index] = reward;
+        if (buffers.done) buffers.done[index] = done ? 1 : 0;
+        writeObservation(index);
+    }
+};
+
+extern "C" {
+
+int tetris3d_api_version(void) {
+    return TETRIS3D_API_VERSION;
+}
+
+tetris3d_env* tetris3d_create(int env_count, int width, int height, int depth, float step_seconds) {
+    if (env_count <= 0 || width <= 0 || width > TETRIS3D_MAX_WIDTH || height <= 0 || height > TETRIS3D_MAX_HEIGHT
+        || depth <= 0 || depth > TETRIS3D_MAX_DEPTH) {
+        return nullptr;
+    }
+    tetris3d_env* env = new tetris3d_env();
+    env->width = width;
+    env->height = height;
+    env->depth = depth;
+    for (int i = 0; i < env_count; ++i) {
+        env->environments.emplace_back(new Environment(width, height, depth, step_seconds));
+    }
+    return env;
+}
+
+void tetris3d_destroy(tetris3d_env* env) {
+    delete env;
+}
+
+int tetris3d_env_count(const tetris3d_env* env) {
+    return static_cast<int>(env->environments.size());
+}
+
+void tetris3d_set_buffers(tetris3d_env* env, const tetris3d_buffers* buffers) {
+    env->buffers = buffers ? *buffers : tetris3d_buffers{};
+}
+
+void tetris3d_reset(tetris3d_env* env, int index, uint32_t seed) {
+    env->environments[index]->reset(seed);
+    if (env->buffers.reward) env->buffers.reward[index] = 0.0f;
+    if (env->buffers.done) env->buffers.done[index] = 0;
+    env->writeObservation(index);
+}
+
+void tetris3d_reset_many(tetris3d_env* env, const uint32_t* seeds) {
+    for (int i = 0; i < tetris3d_env_count(env); ++i) {
+        tetris3d_reset(env, i, seeds[i]);
+    }
+}
+
+void tetris3d_step(tetris3d_env* env, int index, int32_t action) {
+    env->step(index, action);
+}
+
+void tetris3d_step_many(tetris3d_env* env, const int32_t* actions) {
+    for (int i = 0; i < tetris3d_env_count(env); ++i) {
+        env->step(i, actions[i]);
+    }
+}
+
+}
@@ -0,0 +1,71 @@
+#ifndef TETRIS3D_H
+#define TETRIS3D_H
+
+/* Stable C API over the simulation core, for agents and other languages.
+ *
+ * One handle holds a batch of environments that all step together. Observations
+ * are written into buffers the caller registers once with tetris3d_set_buffers,
+ * so stepping copies nothing back and forth. Any buffer may be NULL to skip it.
+ *
+ * Actions: 0 idle, 1 down, 2 left (-x), 3 right (+x), 4 back (-z), 5 forward (+z),
+ *          6 rotate x, 7 rotate y, 8 rotate z, 9 hard drop.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TETRIS3D_API_VERSION 1
+#define TETRIS3D_ACTION_COUNT 10
+
+/* Largest boards: every coordinate must fit the int8_t piece buffer and every column
+ * height the uint8_t heightmap. The width is also the widest dense Grid. */
+#define TETRIS3D_MAX_WIDTH 64
+#define TETRIS3D_MAX_HEIGHT 128
+#define TETRIS3D_MAX_DEPTH 128
+
+typedef struct tetris3d_env tetris3d_env;
+
+/* Layouts, env being the index in the batch */
+typedef struct {
+    uint8_t* occupancy;  /* [env][height][depth][width], 1 when occupied */
+    uint8_t* heightmap;  /* [env][depth][width], highest occupied layer + 1, 0 when empty */
+    int8_t* piece;       /* [env][4][3], x y z of each block of the falling piece */
+    int32_t* piece_ids;  /* [env][2], shape of the falling and of the next piece (0-6) */
+    float* reward;       /* [env], score gained by the last step */
+    uint8_t* done;       /* [env], 1 when the last step ended the game */
+    int32_t* score;      /* [env], score of the current game */
+} tetris3d_buffers;
+
+int tetris3d_api_version(void);
+
+/* step_seconds is the simulated time of one step, gravity included. Returns NULL when a
+ * size is not positive or is above its TETRIS3D_MAX_* limit. */
+tetris3d_env* tetris3d_create(int env_count, int width, int height, int depth, float step_seconds);
+void tetris3d_destroy(tetris3d_env* env);
+
+int tetris3d_env_count(const tetris3d_env* env);
+
+/* The buffers must stay valid until replaced or until tetris3d_destroy */
+void tetris3d_set_buffers(tetris3d_env* env, const tetris3d_buffers* buffers);
+
+/* Starts a new game in one environment and writes its observation */
+void tetris3d_reset(tetris3d_env* env, int index, uint32_t seed);
+
+/* Resets every environment, seeds holds one seed per environment */
+void tetris3d_reset_many(tetris3d_env* env, const uint32_t* seeds);
+
+/* Steps one environment. A game that ends restarts immediately with a derived
+ * seed: done reports the end and the observation shows the new game. */
+void tetris3d_step(tetris3d_env* env, int index, int32_t action);
+
+/* Steps every environment, actions holds one action per environment */
+void tetris3d_step_many(tetris3d_env* env, const int32_t* actions);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,106 @@
+"""NumPy front end of the tetris3d C API.
+
+The observation arrays are allocated once here and filled in place by the
+library on every call: reset() and step() return the same arrays each time,
+without copies. Copy them if an older observation must be kept.
+
+    env = VectorEnv(num_envs=256)
+    obs = env.reset(seed=0)
+    obs, reward, done = env.step(np.random.randint(0, VectorEnv.ACTION_COUNT, 256))
+"""
+
+import ctypes
+import os
+
+import numpy as np
+
+ACTIONS = ("idle", "down", "left", "right", "back", "forward",
+           "rotate_x", "rotate_y", "rotate_z", "hard_drop")
+
+
+class _Buffers(ctypes.Structure):
+    _fields_ = [
+        ("occupancy", ctypes.c_void_p),
+        ("heightmap", ctypes.c_void_p),
+        ("piece", ctypes.c_void_p),
+        ("piece_ids", ctypes.c_void_p),
+        ("reward", ctypes.c_void_p),
+        ("done", ctypes.c_void_p),
+        ("score", ctypes.c_void_p),
+    ]
+
+
+def _load(path):
+    lib = ctypes.CDLL(path)
+    lib.tetris3d_api_version.restype = ctypes.c_int
+    lib.tetris3d_create.restype = ctypes.c_void_p
+    lib.tetris3d_create.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_float]
+    lib.tetris3d_destroy.argtypes = [ctypes.c_void_p]
+    lib.tetris3d_set_buffers.argtypes = [ctypes.c_void_p, ctypes.POINTER(_Buffers)]
+    lib.tetris3d_reset.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_uint32]
+    lib.tetris3d_reset_many.argtypes = [ctypes.c_void_p, ctypes.c_void_p]
+    lib.tetris3d_step.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int32]
+    lib.tetris3d_step_many.argtypes = [ctypes.c_void_p, ctypes.c_void_p]
+    if lib.tetris3d_api_version() != 1:
+        raise RuntimeError("unsupported tetris3d API version %d" % lib.tetris3d_api_version())
+    return lib
+
+
+class VectorEnv:
+    ACTION_COUNT = len(ACTIONS)
+
+    def __init__(self, num_envs, width=4, height=16, depth=4, step_seconds=0.1, library=None):
+        if library is None:
+            library = os.environ.get("TETRIS3D_LIBRARY",
+                                     os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "libtetris3d.so"))
+        self._lib = _load(library)
+        self._env = self._lib.tetris3d_create(num_envs, width, height, depth, step_seconds)
+        if not self._env:
+            raise ValueError("invalid environment size")
+
+        self.num_envs = num_envs
+        self.occupancy = np.zeros((num_envs, height, depth, width), dtype=np.uint8)
+        self.heightmap = np.zeros((num_envs, depth, width), dtype=np.uint8)
+        self.piece = np.zeros((num_envs, 4, 3), dtype=np.int8)
+        self.piece_ids = np.zeros((num_envs, 2), dtype=np.int32)
+        self.reward = np.zeros(num_envs, dtype=np.float32)
+        self.done = np.zeros(num_envs, dtype=np.uint8)
+        self.score = np.zeros(num_envs, dtype=np.int32)
+
+        # The library keeps these pointers: the arrays must live as long as the handle
+        self._buffers = _Buffers(*(array.ctypes.data for array in (
+            self.occupancy, self.heightmap, self.piece, self.piece_ids, self.reward, self.done, self.score)))
+        self._lib.tetris3d_set_buffers(self._env, ctypes.byref(self._buffers))
+        self._actions = np.zeros(num_envs, dtype=np.int32)
+
+    def observation(self):
+        return {
+            "occupancy": self.occupancy,
+            "heightmap": self.heightmap,
+            "piece": self.piece,
+            "piece_ids": self.piece_ids,
+            "score": self.score,
+        }
+
+    def reset(self, seed=0):
+        """Restarts every game; seed is either one base seed or one seed per environment."""
+        seeds = np.asarray(seed, dtype=np.uint32)
+        if seeds.ndim == 0:
+            seeds = seeds + np.arange(self.num_envs, dtype=np.uint32)
+        seeds = np.ascontiguousarray(seeds, dtype=np.uint32)
+        self._lib.tetris3d_reset_many(self._env, seeds.ctypes.data)
+        return self.observation()
+
+    def step(self, actions):
+        """One action per environment. Finished games restart at once, flagged in done."""
+        np.copyto(self._actions, actions, casting="unsafe")
+        self._lib.tetris3d_step_many(self._env, self._actions.ctypes.data)
+        return self.observation(), self.reward, self.done
+
+    def close(self):
+        if self._env:
+            self._lib.tetris3d_destroy(self._env)
+            self._env = None
+
+    def __del__(self):
+        self.close()
@@ -2,25 +2,173 @@
 #include "src/InputHandler.h"
 #include "src/Menu.h"
 #include "src/HowToPlayScreen.h"
+#include "src/InputQueue.h"
+#include "src/LatencyTracker.h"
+#include "src/FrameScheduler.h"
+#include "src/SpectatorWall.h"
+#include "src/DemoPlayer.h"
+#include "src/SpectatorFeed.h"
+#include "src/Metrics.h"
+#include "src/Trace.h"
+#include "src/StartupTimeline.h"
+#include "src/FrameArena.h"
+#include "src/AllocationCounter.h"
+#include "src/FrameCapture.h"
+#include "src/TrainingData.h"
+#include "src/DynamicResolution.h"
+#include <cstdlib>
+#include <cstring>
 
 InputHandler inputHandler;
+InputQueue inputQueue;
+bool showDebugOverlay = false;
+bool traceRequested = false;
+StartupTimeline startupTimeline;
+// Transient per-frame data such as overlay strings, emptied after every glfwSwapBuffers
+FrameArena frameArena;
+allocations::FrameMonitor allocationMonitor;
+// Set by --capture: every frame shown is also recorded to a video file
+std::unique_ptr<FrameCapture> frameCapture;
+// Set by --dynamic-resolution: the game scene is rendered offscreen at a size that holds the frame budget
+std::unique_ptr<DynamicResolution> dynamicResolution;
 
+// Only records the event: the simulation drains the queue once per tick
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-    if (action == GLFW_PRESS || action == GLFW_REPEAT) {
-        Game* game = reinterpret_cast<Game*>(glfwGetWindowUserPointer(window));
-        if (game) {
-            inputHandler.handleInput(key, *game);
-        }
+    if (action == GLFW_PRESS || action == GLFW_RELEASE) {
+        inputQueue.push({key, action, glfwGetTime()});
+    }
+    if (key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+        showDebugOverlay = !showDebugOverlay;
     }
+    if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
+        traceRequested = true;
+    }
+}
+
+
+std::string shaderCacheSummary() {
+    const ProgramCache::Stats& stats = ProgramCache::stats();
+    return "shader cache " + std::to_string(stats.hits) + " hits, " + std::to_string(stats.misses) + " misses";
 }
 
+// Writes the last frames, reports the drops and frees the GL objects while the context still exists
+void stopCapture() {
+    if (frameCapture) {
+        frameCapture->cleanUp();
+        frameCapture->report();
+        frameCapture.reset();
+    }
+}
 
 // Callback function to adjust the OpenGL viewport when the window is resized
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
+    if (dynamicResolution) {
+        dynamicResolution->resize(width, height);
+    }
+    // The window is not resizable while capturing, but a move to a screen of another scale
+    // still changes the framebuffer: the video keeps its size, so the capture ends there.
+    // A minimized window reports 0x0 and is left alone.
+    if (frameCapture && width > 0 && height > 0 && !frameCapture->hasSize(width, height)) {
+        std::cerr << "[Capture] Framebuffer resized to " << width << "x" << height << ", capture stopped" << std::endl;
+        stopCapture();
+    }
+}
+
+// Spectator wall: boardCount demo games played automatically and shown at once
+int runSpectatorWall(GLFWwindow* window, FrameScheduler& scheduler, int boardCount) {
+    UIRenderer ui;
+    SpectatorWall wall(ui, 4, 16, 4);
+    std::vector<std::unique_ptr<Game>> games;
+    std::vector<DemoPlayer> players;
+    for (int i = 0; i < boardCount; ++i) {
+        games.push_back(std::unique_ptr<Game>(new Game(4, 16, 4)));
+        players.push_back(DemoPlayer(1234u + i));
+    }
+    startupTimeline.mark("spectator wall");
+
+    scheduler.resetTicks();
+    while (!glfwWindowShouldClose(window)) {
+        scheduler.beginFrame(true);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        int ticks = scheduler.consumeTicks();
+        for (int i = 0; i < ticks; ++i) {
+            for (int board = 0; board < boardCount; ++board) {
+                if (!games[board]->getIsRunning()) {
+                    games[board]->start();
+                }
+                players[board].play(*games[board]);
+                games[board]->update(scheduler.getTickSeconds());
+            }
+        }
+        wall.render(games);
+
+        if (frameCapture) {
+            frameCapture->capture();
+        }
+        glfwSwapBuffers(window);
+        frameArena.reset();
+        if (!startupTimeline.isReported()) {
+            startupTimeline.reportFirstFrame(shaderCacheSummary());
+        }
+        allocationMonitor.endFrame(true);
+        scheduler.waitForNextFrame();
+    }
+    return 0;
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // --gpu-latency also measures input latency up to GPU completion of the presenting frame
+    // --fps N disables vsync and caps the frame rate instead
+    // --wall N shows N automatically played boards instead of the game
+    // --feed NAME publishes the game state after every tick to the shared memory object NAME
+    // --metrics-file PATH writes Prometheus metrics to PATH every 15 seconds
+    // --gravity G replaces the level gravity curve by G cells per 1/60 s, up to 20
+    // --zero-alloc aborts on any heap allocation in a steady-state frame (builds with -DTETRIS_COUNT_ALLOCATIONS)
+    // --capture PATH records every frame to PATH: Y4M for *.y4m or - (stdout), raw RGB24 otherwise
+    // --dynamic-resolution renders the game scene at a lower resolution whenever it would miss the frame rate
+    // --export PATH writes a training record for every piece locked to PATH, see TrainingData.h
+    bool gpuLatency = false;
+    int wallBoards = 0;
+    std::string feedName;
+    std::string metricsPath;
+    PacingMode pacingMode = PacingMode::VSync;
+    double fpsCap = 60.0;
+    float gravity = -1.0f;
+    std::string capturePath;
+    bool dynamicScaling = false;
+    std::string exportPath;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--gpu-latency") == 0) {
+            gpuLatency = true;
+        } else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            pacingMode = PacingMode::FpsCap;
+            fpsCap = std::max(1.0, std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--wall") == 0 && i + 1 < argc) {
+            wallBoards = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--feed") == 0 && i + 1 < argc) {
+            feedName = argv[++i];
+        } else if (std::strcmp(argv[i], "--metrics-file") == 0 && i + 1 < argc) {
+            metricsPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--zero-alloc") == 0) {
+            allocationMonitor = allocations::FrameMonitor(true);
+        } else if (std::strcmp(argv[i], "--gravity") == 0 && i + 1 < argc) {
+            gravity = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        } else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capturePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--dynamic-resolution") == 0) {
+            dynamicScaling = true;
+        } else if (std::strcmp(argv[i], "--export") == 0 && i + 1 < argc) {
+            exportPath = argv[++i];
+        }
+    }
+
+    std::unique_ptr<metrics::TextFileExporter> metricsExporter;
+    if (!metricsPath.empty()) {
+        metricsExporter.reset(new metrics::TextFileExporter(metricsPath));
+    }
+
     // Initialize GLFW
     if (!glfwInit()) {
         std::cerr << "Error: Failed to initialize GLFW" << std::endl;
@@ -31,6 +179,10 @@ int main() {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // A capture records frames of the size the window starts with
+    if (!capturePath.empty()) {
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    }
 
     GLFWwindow* window = glfwCreateWindow(1600, 1200, "Tetris 3D", nullptr, nullptr);
     if (!window) {
@@ -39,6 +191,7 @@ int main() {
         return -1;
     }
     glfwMakeContextCurrent(window);
+    startupTimeline.mark("window and context");
 
     // Initialize GLEW
     glewExperimental = GL_TRUE;
@@ -54,37 +207,160 @@ int main() {
     glfwGetFramebufferSize(window, &viewportWidth, &viewportHeight);
     glViewport(0, 0, viewportWidth, viewportHeight);
     glEnable(GL_DEPTH_TEST);
+    // Keeps the viewport and the dynamic resolution targets at the window size
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    startupTimeline.mark("GLEW and GL state");
+
+    if (!capturePath.empty()) {
+        frameCapture.reset(new FrameCapture(capturePath, viewportWidth, viewportHeight, static_cast<int>(pacingMode == PacingMode::FpsCap ? fpsCap : 60.0)));
+        if (!frameCapture->isOpen()) {
+            frameCapture.reset();
+        }
+    }
+
+    if (wallBoards > 0) {
+        FrameScheduler scheduler(pacingMode, fpsCap);
+        scheduler.configure();
+        int result = runSpectatorWall(window, scheduler, wallBoards);
+        stopCapture();
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return result;
+    }
+
+    if (dynamicScaling) {
+        // Three quarters of a frame for the scene, the rest for the HUD, the upscale and the swap
+        double frameSeconds = 1.0 / (pacingMode == PacingMode::FpsCap ? fpsCap : 60.0);
+        dynamicResolution.reset(new DynamicResolution(viewportWidth, viewportHeight, static_cast<float>(frameSeconds * 0.75 * 1000.0)));
+    }
 
     // Set the initial game state
     GameState state = MenuPrincipal;
     Game game(4, 16, 4);
-    Renderer renderer;
-    Menu menu(window, state);
-    HowToPlayScreen howToPlayScreen(window, state);
+    game.setGravity(gravity);
+    startupTimeline.mark("game");
+    UIRenderer ui;
+    startupTimeline.mark("UI renderer and atlas");
+    Menu menu(window, state, ui);
+    startupTimeline.mark("menu");
+    // The game view and the help screen are only built the first time they are shown
+    std::unique_ptr<Renderer> renderer;
+    std::unique_ptr<HowToPlayScreen> howToPlayScreen;
+    LatencyTracker latencyTracker(gpuLatency);
+    inputHandler.setLatencyTracker(&latencyTracker);
+
+    std::unique_ptr<SpectatorFeedWriter> feedWriter;
+    if (!feedName.empty()) {
+        feedWriter.reset(new SpectatorFeedWriter(feedName, 4, 16, 4));
+    }
+    uint64_t tickCount = 0;
+
+    std::unique_ptr<TrainingExporter> trainingExporter;
+    std::unique_ptr<TrainingRecorder> trainingRecorder;
+    if (!exportPath.empty()) {
+        trainingExporter.reset(new TrainingExporter(exportPath, 4, 16, 4));
+        if (trainingExporter->isOpen()) {
+            trainingRecorder.reset(new TrainingRecorder(*trainingExporter));
+            trainingRecorder->follow(game);
+        }
+    }
 
     glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)viewportWidth / viewportHeight, 0.1f, 100.0f);
     glm::mat4 view = glm::lookAt(glm::vec3(15, 25, 15), glm::vec3(5, 10, 5), glm::vec3(0, 1, 0));
 
+    glfwSetKeyCallback(window, key_callback);
+
+    FrameScheduler scheduler(pacingMode, fpsCap);
+    scheduler.configure();
+    bool continuousFrame = false;
+    startupTimeline.mark("tracking and feeds");
+
     // Main loop
     while (!glfwWindowShouldClose(window)) {
+        scheduler.beginFrame(continuousFrame);
+        // The GPU mostly finishes the last frame during the pacing wait, stamp its fence now
+        latencyTracker.pollGpuFences(glfwGetTime());
+        GameState frameState = state;
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glfwSetWindowUserPointer(window, &game);
-                glfwSetKeyCallback(window, key_callback);
-        
+
+        if (state != Playing) {
+            // Keys pressed outside the game must not move the piece
+            inputQueue.clear();
+            inputHandler.reset();
+            scheduler.resetTicks();
+        }
+
         switch (state) {
             case MenuPrincipal:
                 menu.displayMenu(); // display the menu
                 break;
             case Playing:
+                if (!renderer) {
+                    startupTimeline.restart();
+                    renderer.reset(new Renderer(ui));
+                    startupTimeline.mark("game renderer");
+                }
                 if(game.getIsRunning()){
-                    game.update(0.016f); // Start the game
-                    renderer.renderGame(game, projection, view);
+                    // The simulation runs at a fixed tick rate whatever the frame rate
+                    int ticks = scheduler.consumeTicks();
+                    for (int i = 0; i < ticks && game.getIsRunning(); ++i) {
+                        {
+                            TRACE_SCOPE("InputHandler::processInput");
+                            inputHandler.processInput(inputQueue, game);
+                        }
+                        game.update(scheduler.getTickSeconds());
+                        if (feedWriter) {
+                            feedWriter->publish(game, ++tickCount);
+                        }
+                        if (trainingRecorder) {
+                            trainingRecorder->observe(game);
+                        }
+                    }
+                    if (dynamicResolution) {
+                        dynamicResolution->beginScene();
+                    }
+                    renderer->renderGame(game, projection, view);
+                    if (dynamicResolution) {
+                        dynamicResolution->endScene();
+                    }
+                    renderer->renderHud(game);
+                    if (showDebugOverlay) {
+                        renderer->renderDebugText(latencyTracker.overlayText(frameArena), 0);
+                        renderer->renderDebugText(scheduler.getSummary().c_str(), 1);
+                        if (allocations::ENABLED) {
+                            renderer->renderDebugText(frameArena.format("Allocations: %llu last frame, %llu max steady, %llu frames over 0",
+                                                                        (unsigned long long)allocationMonitor.getLastFrame(),
+                                                                        (unsigned long long)allocationMonitor.getMaxSteadyFrame(),
+                                                                        (unsigned long long)allocationMonitor.getViolations()), 2);
+                        }
+                        if (frameCapture) {
+                            renderer->renderDebugText(frameArena.format("Capture: %llu frames, %llu dropped",
+                                                                        (unsigned long long)frameCapture->getCaptured(),
+                                                                        (unsigned long long)frameCapture->getDropped()), 3);
+                        }
+                        if (dynamicResolution) {
+                            renderer->renderDebugText(frameArena.format("Resolution: %d%% (%dx%d), scene %.1f ms of %.1f ms, %llu changes",
+                                                                        static_cast<int>(dynamicResolution->getScale() * 100.0f + 0.5f),
+                                                                        dynamicResolution->getRenderWidth(), dynamicResolution->getRenderHeight(),
+                                                                        dynamicResolution->getSceneMs(), dynamicResolution->getBudgetMs(),
+                                                                        (unsigned long long)dynamicResolution->getScaleChanges()), 4);
+                        }
+                        const RenderStats& renderStats = renderer->getRenderStats();
+                        renderer->renderDebugText(frameArena.format("Render: %u commands, %u draws, %u state changes",
+                                                                    renderStats.commands, renderStats.drawCalls, renderStats.stateChanges), 5);
+                    }
+                    renderer->flushText();
                 } else {
                     state = GameOver;
                 }
                 break;
             case HowToPlay:
-                howToPlayScreen.display();
+                if (!howToPlayScreen) {
+                    startupTimeline.restart();
+                    howToPlayScreen.reset(new HowToPlayScreen(window, state, ui));
+                    startupTimeline.mark("help screen");
+                }
+                howToPlayScreen->display();
                 break;
             case GameOver:
                 game.start();
@@ -93,12 +369,59 @@ int main() {
                 break;
         }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (frameCapture) {
+            TRACE_SCOPE("FrameCapture::capture");
+            frameCapture->capture();
+        }
+        {
+            TRACE_SCOPE("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+        }
+        frameArena.reset();
+        if (!startupTimeline.isReported()) {
+            startupTimeline.reportFirstFrame(shaderCacheSummary());
+        }
+        double now = glfwGetTime();
+        latencyTracker.onFramePresented(now);
+        latencyTracker.pollGpuFences(now);
+        latencyTracker.report(now);
+
+        // Menu and help screens only change on input or at the title animation rate
+        double animationInterval = 0.0;
+        if (state == MenuPrincipal) {
+            animationInterval = 1.0 / 30.0;
+        } else if (state == HowToPlay) {
+            animationInterval = 0.5;
+        }
+        continuousFrame = animationInterval == 0.0;
+        bool steadyFrame = state == frameState && !traceRequested;
+        if (traceRequested) {
+            traceRequested = false;
+            TRACE_WRITE("trace-" + std::to_string(static_cast<long>(now)) + ".json");
+        }
+        allocationMonitor.endFrame(steadyFrame);
+        {
+            TRACE_SCOPE("waitForNextFrame");
+            scheduler.waitForNextFrame(animationInterval);
+        }
     }
 
+    TRACE_WRITE("trace.json");
+
 
     // Clean up
+    if (trainingRecorder) {
+        // The game left unfinished is kept with its current score
+        trainingRecorder->finish();
+        trainingExporter->finish();
+        trainingExporter->report(stderr);
+    }
+    latencyTracker.cleanUp();
+    stopCapture();
+    if (dynamicResolution) {
+        dynamicResolution->cleanUp();
+        dynamicResolution.reset();
+    }
     glfwDestroyWindow(window);
     glfwTerminate();
     return 0;
@@ -0,0 +1,379 @@
+// Randomized soak test: plays random action sequences on Game and on the naive
+// ReferenceModel at the same time and checks they agree after every tick. A
+// divergence is shrunk to a minimal action sequence and printed with its seed.
+//
+// Build: g++ -O2 soak.cpp -o soak -pthread
+// Usage: ./soak [--seconds S] [--threads N] [--seed S]
+//   --seconds S  stop after S seconds (default 60)
+//   --threads N  worker threads (default: every core)
+//   --seed S     replay the single game of seed S
+//   --sparse     run the games on the sparse board storage
+#include "src/Game.h"
+#include "src/ReferenceModel.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+const int WIDTH = 4, HEIGHT = 16, DEPTH = 4;
+const int STEPS_PER_GAME = 20000;
+Grid::Storage storage = Grid::Storage::Auto;
+
+// One step is an action followed by one update. Actions go straight to the Game
+// API, so the runner needs neither a window nor a GL context.
+enum Action : uint8_t {
+    Idle, Down, Left, Right, Back, Forward, RotateX, RotateY, RotateZ, HardDrop, ACTION_COUNT
+};
+const uint8_t LONG_TICK = 0x80; // The update lasts a whole second, so gravity or the lock delay always applies
+
+const char* ACTION_NAMES[ACTION_COUNT] = {
+    "idle", "down", "left", "right", "back", "forward", "rotate-x", "rotate-y", "rotate-z", "hard-drop"
+};
+
+std::string describe(uint8_t step) {
+    return std::string(ACTION_NAMES[step & ~LONG_TICK]) + ((step & LONG_TICK) ? "+long" : "");
+}
+
+Tetromino moved(Tetromino tetromino, const glm::vec3& direction) {
+    tetromino.move(direction);
+    return tetromino;
+}
+
+bool samePiece(const Tetromino& a, const Tetromino& b) {
+    const std::vector<Block>& blocksA = a.getBlocks();
+    const std::vector<Block>& blocksB = b.getBlocks();
+    if (blocksA.size() != blocksB.size()) return false;
+    for (size_t i = 0; i < blocksA.size(); ++i) {
+        if (blocksA[i].getPosition() != blocksB[i].getPosition()) return false;
+    }
+    return true;
+}
+
+// A game and its reference model, advanced in lockstep
+class Session {
+    private:
+        Game game;
+        ReferenceModel reference;
+        GameEventReader events;
+        std::mt19937 checkRng; // Picks what the occasional extra checks look at
+
+        bool drainEvents(bool& locked, bool& movedDown) {
+            GameEvent event;
+            locked = movedDown = false;
+            while (events.poll(game.getEvents(), event)) {
+                locked = locked || event.type == GameEventType::PieceLocked;
+                movedDown = movedDown || event.type == GameEventType::PieceMoved;
+            }
+            return !events.checkOverflow();
+        }
+
+        bool compareBoards(std::string& failure) const {
+            const Grid& grid = game.getGrid();
+            for (int y = 0; y < HEIGHT; ++y) {
+                for (int z = 0; z < DEPTH; ++z) {
+                    for (int x = 0; x < WIDTH; ++x) {
+                        if (grid.isCellOccupied(x, y, z) != reference.isCellOccupied(x, y, z)) {
+                            failure = "cell " + std::to_string(x) + "," + std::to_string(y) + "," + std::to_string(z) + " differs";
+                            return false;
+                        }
+                    }
+                }
+            }
+            if (grid.getHash() != grid.computeHash()) {
+                failure = "incremental board hash differs from the cells";
+                return false;
+            }
+            if (game.getScore() != reference.getScore() || game.getTotalLinesCleared() != reference.getLinesCleared() || game.getLevel() != reference.getLevel()) {
+                failure = "score " + std::to_string(game.getScore()) + " lines " + std::to_string(game.getTotalLinesCleared()) + " level " + std::to_string(game.getLevel())
+                        + ", reference " + std::to_string(reference.getScore()) + " / " + std::to_string(reference.getLinesCleared()) + " / " + std::to_string(reference.getLevel());
+                return false;
+            }
+            return true;
+        }
+
+        // Grid::queryFits at one random layer against one collision test per translation
+        bool compareBatchQuery(std::string& failure) {
+            Tetromino piece = game.getCurrentTetromino();
+            int y = std::uniform_int_distribution<>(0, HEIGHT - 1)(checkRng);
+            uint64_t fits[DEPTH];
+            game.getGrid().queryFits(piece, y, fits);
+
+            glm::vec3 minPos = piece.getBlocks()[0].getPosition();
+            for (const Block& block : piece.getBlocks()) {
+                minPos = glm::vec3(std::min(minPos.x, block.getPosition().x), std::min(minPos.y, block.getPosition().y), std::min(minPos.z, block.getPosition().z));
+            }
+            for (int z = 0; z < DEPTH; ++z) {
+                for (int x = 0; x < WIDTH; ++x) {
+                    bool expected = !reference.collides(moved(piece, glm::vec3(x - minPos.x, y - minPos.y, z - minPos.z)));
+                    if (((fits[z] >> x) & 1) != expected) {
+                        failure = "queryFits differs at " + std::to_string(x) + "," + std::to_string(y) + "," + std::to_string(z);
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+    public:
+        Session(unsigned seed): game(WIDTH, HEIGHT, DEPTH, seed, storage), reference(WIDTH, HEIGHT, DEPTH), checkRng(seed) {}
+
+        // Applies one step to both sides, returns false with a reason on the first disagreement
+        bool step(uint8_t step, std::string& failure) {
+            bool locked, movedDown;
+            Tetromino before = game.getCurrentTetromino();
+            Action action = static_cast<Action>(step & ~LONG_TICK);
+
+            if (action >= Down && action <= Forward) {
+                const glm::vec3 DIRECTIONS[] = { glm::vec3(0, -1, 0), glm::vec3(-1, 0, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, -1), glm::vec3(0, 0, 1) };
+                glm::vec3 direction = DIRECTIONS[action - Down];
+                Tetromino expected = moved(before, direction);
+                bool fits = !reference.collides(expected);
+                if (game.moveTetromino(direction) != fits) {
+                    failure = std::string("move ") + (fits ? "rejected" : "accepted") + " against the reference";
+                    return false;
+                }
+                if (!samePiece(game.getCurrentTetromino(), fits ? expected : before)) {
+                    failure = "piece misplaced after a move";
+                    return false;
+                }
+            } else if (action >= RotateX && action <= RotateZ) {
+                const glm::vec3 AXES[] = { glm::vec3(1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, 0, 1) };
+                bool accepted = game.rotateTetromino(90.0f, AXES[action - RotateX]);
+                if (accepted ? reference.collides(game.getCurrentTetromino()) : !samePiece(game.getCurrentTetromino(), before)) {
+                    failure = accepted ? "rotation accepted into a collision" : "rejected rotation moved the piece";
+                    return false;
+                }
+            } else if (action == HardDrop) {
+                Tetromino expected = reference.drop(before);
+                game.moveTetrominoToProjectedPosition();
+                if (!samePiece(game.getCurrentTetromino(), expected)) {
+                    failure = "hard drop landed elsewhere";
+                    return false;
+                }
+            }
+            drainEvents(locked, movedDown);
+
+            before = game.getCurrentTetromino();
+            game.update((step & LONG_TICK) ? 1.0f : 0.016f);
+            if (!drainEvents(locked, movedDown)) {
+                failure = "event buffer overflow";
+                return false;
+            }
+
+            if (locked) {
+                if (!reference.collides(moved(before, glm::vec3(0, -1, 0)))) {
+                    failure = "piece locked while it could still fall";
+                    return false;
+                }
+                reference.lock(before);
+                if (!compareBoards(failure)) {
+                    return false;
+                }
+                bool spawnFits = !reference.collides(game.getCurrentTetromino());
+                if (game.getIsRunning() != spawnFits) {
+                    failure = std::string("game over ") + (spawnFits ? "with room to spawn" : "missed");
+                    return false;
+                }
+                if (game.getIsRunning() && !compareBatchQuery(failure)) {
+                    return false;
+                }
+            } else {
+                // Gravity may move several cells at once, never past where the piece lands
+                Tetromino current = game.getCurrentTetromino();
+                int fallen = static_cast<int>(before.getBlocks()[0].getPosition().y - current.getBlocks()[0].getPosition().y);
+                if (!samePiece(current, moved(before, glm::vec3(0, -fallen, 0))) || (fallen > 0) != movedDown) {
+                    failure = "gravity misplaced the piece";
+                    return false;
+                } else if (fallen > 0 && !samePiece(reference.drop(current), reference.drop(before))) {
+                    failure = "gravity moved the piece past its landing cell";
+                    return false;
+                }
+            }
+
+            if (!game.getIsRunning()) {
+                game.start();
+                reference.reset();
+                drainEvents(locked, movedDown);
+            }
+            return true;
+        }
+};
+
+std::vector<uint8_t> randomSteps(unsigned seed, int count) {
+    std::mt19937 rng(seed ^ 0x9e3779b9u);
+    std::uniform_int_distribution<> actions(0, 2 * ACTION_COUNT - 1); // Idle half the time
+    std::uniform_int_distribution<> longTicks(0, 3);
+    std::vector<uint8_t> steps(count);
+    for (uint8_t& step : steps) {
+        int action = actions(rng);
+        step = static_cast<uint8_t>(action < ACTION_COUNT ? action : Idle);
+        if (longTicks(rng) == 0) {
+            step |= LONG_TICK;
+        }
+    }
+    return steps;
+}
+
+// Index of the first failing step, or -1 when the whole sequence agrees
+int replay(unsigned seed, const std::vector<uint8_t>& steps, std::string& failure) {
+    Session session(seed);
+    for (size_t i = 0; i < steps.size(); ++i) {
+        if (!session.step(steps[i], failure)) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+// Removes ever smaller chunks of steps as long as the sequence still fails
+std::vector<uint8_t> shrink(unsigned seed, std::vector<uint8_t> steps, int failingStep) {
+    std::string failure;
+    steps.resize(failingStep + 1);
+    for (size_t chunk = steps.size() / 2; chunk >= 1; chunk /= 2) {
+        size_t start = 0;
+        while (start < steps.size()) {
+            std::vector<uint8_t> candidate(steps.begin(), steps.begin() + start);
+            candidate.insert(candidate.end(), steps.begin() + std::min(steps.size(), start + chunk), steps.end());
+            int failing = replay(seed, candidate, failure);
+            if (failing >= 0) {
+                candidate.resize(failing + 1);
+                steps = candidate;
+            } else {
+                start += chunk;
+            }
+        }
+    }
+    return steps;
+}
+
+struct alignas(64) WorkerStats {
+    std::atomic<uint64_t> ticks{0};
+};
+
+struct Failure {
+    std::mutex mutex;
+    std::atomic<bool> found{false};
+    unsigned seed = 0;
+    std::vector<uint8_t> steps;
+    int failingStep = -1;
+};
+
+void worker(std::atomic<unsigned>& nextSeed, const std::atomic<bool>& stop, WorkerStats& stats, Failure& failure) {
+    std::string reason;
+    while (!stop.load(std::memory_order_relaxed)) {
+        unsigned seed = nextSeed.fetch_add(1);
+        std::vector<uint8_t> steps = randomSteps(seed, STEPS_PER_GAME);
+        Session session(seed);
+        for (size_t i = 0; i < steps.size(); ++i) {
+            if (!session.step(steps[i], reason)) {
+                std::lock_guard<std::mutex> lock(failure.mutex);
+                if (!failure.found.exchange(true)) {
+                    failure.seed = seed;
+                    failure.steps = steps;
+                    failure.failingStep = static_cast<int>(i);
+                }
+                return;
+            }
+            if ((i & 1023) == 1023) {
+                stats.ticks.store(stats.ticks.load(std::memory_order_relaxed) + 1024, std::memory_order_relaxed);
+                if (stop.load(std::memory_order_relaxed)) return;
+            }
+        }
+    }
+}
+
+int reportFailure(unsigned seed, const std::vector<uint8_t>& steps, int failingStep) {
+    std::cout << "[Soak] Divergence with seed " << seed << " at step " << failingStep << ", shrinking..." << std::endl;
+    std::vector<uint8_t> minimal = shrink(seed, steps, failingStep);
+    std::string reason;
+    replay(seed, minimal, reason);
+    std::cout << "[Soak] Minimal sequence (" << minimal.size() << " steps) for seed " << seed << ": " << reason << std::endl;
+    for (size_t i = 0; i < minimal.size(); ++i) {
+        std::cout << (i ? " " : "  ") << describe(minimal[i]);
+    }
+    std::cout << std::endl;
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    double seconds = 60.0;
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    bool replaySeed = false;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            replaySeed = true;
+            seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--sparse") == 0) {
+            storage = Grid::Storage::Sparse;
+        }
+    }
+
+    if (replaySeed) {
+        std::vector<uint8_t> steps = randomSteps(seed, STEPS_PER_GAME);
+        std::string reason;
+        int failingStep = replay(seed, steps, reason);
+        if (failingStep >= 0) {
+            return reportFailure(seed, steps, failingStep);
+        }
+        std::cout << "[Soak] Seed " << seed << " agrees with the reference over " << steps.size() << " steps" << std::endl;
+        return 0;
+    }
+
+    std::atomic<unsigned> nextSeed{static_cast<unsigned>(std::random_device()())};
+    std::atomic<bool> stop{false};
+    std::unique_ptr<WorkerStats[]> stats(new WorkerStats[threadCount]);
+    Failure failure;
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        threads.emplace_back(worker, std::ref(nextSeed), std::cref(stop), std::ref(stats[t]), std::ref(failure));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto lastReport = start;
+    uint64_t lastTotal = 0;
+    while (!failure.found.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        bool done = elapsed >= seconds;
+        if (done || now - lastReport >= std::chrono::seconds(5)) {
+            uint64_t total = 0;
+            for (unsigned t = 0; t < threadCount; ++t) {
+                total += stats[t].ticks.load(std::memory_order_relaxed);
+            }
+            double interval = std::chrono::duration<double>(now - lastReport).count();
+            double rate = (total - lastTotal) / interval;
+            char line[200];
+            std::snprintf(line, sizeof(line), "[Soak] %.0f s: %llu ticks, %.2f M ticks/s (%.2f M per thread, %u threads)",
+                          elapsed, (unsigned long long)total, rate / 1e6, rate / 1e6 / threadCount, threadCount);
+            std::cout << line << std::endl;
+            lastReport = now;
+            lastTotal = total;
+        }
+        if (done) break;
+    }
+    stop.store(true);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    if (failure.found.load()) {
+        return reportFailure(failure.seed, failure.steps, failure.failingStep);
+    }
+    std::cout << "[Soak] No divergence" << std::endl;
+    return 0;
+}
@@ -0,0 +1,105 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+// Heap allocation counting for debug and benchmark builds. With
+// -DTETRIS_COUNT_ALLOCATIONS the global operator new is replaced by one that
+// counts the allocations of the calling thread, so helper threads (metrics
+// exporter, feeds) do not show up in the frame counts. The replacement must
+// only be defined once per program: include this header from the file with
+// main() only. Without the flag the counts stay at zero and nothing is replaced.
+namespace allocations {
+
+#ifdef TETRIS_COUNT_ALLOCATIONS
+    constexpr bool ENABLED = true;
+#else
+    constexpr bool ENABLED = false;
+#endif
+
+    inline uint64_t& threadCount() {
+        static thread_local uint64_t count = 0;
+        return count;
+    }
+
+    // Allocations made so far by the calling thread
+    inline uint64_t count() {
+        return threadCount();
+    }
+
+    // Allocations between consecutive endFrame() calls. Once a frame is steady,
+    // i.e. the same screen has been shown for warmupFrames frames, any
+    // allocation is a violation; strict monitors abort on the first one.
+    class FrameMonitor {
+        private:
+            uint64_t frameStart = count();
+            uint64_t lastFrame = 0;
+            uint64_t maxSteadyFrame = 0;
+            uint64_t violations = 0;
+            int steadyFrames = 0;
+            int warmupFrames;
+            bool strict;
+
+        public:
+            explicit FrameMonitor(bool strict = false, int warmupFrames = 120): warmupFrames(warmupFrames), strict(strict) {}
+
+            void endFrame(bool steady) {
+                uint64_t now = count();
+                lastFrame = now - frameStart;
+                steadyFrames = steady ? steadyFrames + 1 : 0;
+                if (steadyFrames > warmupFrames) {
+                    maxSteadyFrame = std::max(maxSteadyFrame, lastFrame);
+                    if (lastFrame > 0) {
+                        if (violations++ == 0 || strict) {
+                            std::cerr << "[Error] " << lastFrame << " heap allocations in a steady-state frame" << std::endl;
+                        }
+                        if (strict) {
+                            std::abort();
+                        }
+                    }
+                }
+                // The report itself may allocate, start counting after it
+                frameStart = count();
+            }
+
+            uint64_t getLastFrame() const { return lastFrame; }
+            uint64_t getMaxSteadyFrame() const { return maxSteadyFrame; }
+            uint64_t getViolations() const { return violations; }
+    };
+}
+
+#ifdef TETRIS_COUNT_ALLOCATIONS
+void* operator new(std::size_t size) {
+    allocations::threadCount()++;
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+#endif
+
+#endif
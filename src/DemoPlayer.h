@@ -0,0 +1,59 @@
+#ifndef DEMOPLAYER_H
+#define DEMOPLAYER_H
+
+#include "Game.h"
+#include "GameEvents.h"
+#include <random>
+
+// Minimal automatic player used to fill the spectator wall: when a piece spawns it
+// picks a random rotation and offset, walks the piece there one step every few
+// ticks and hard drops it.
+class DemoPlayer {
+    private:
+        const int TICKS_PER_STEP = 4;
+
+        std::mt19937 rng;
+        GameEventReader events;
+        int rotations = 0;
+        int shiftX = 0, shiftZ = 0;
+        bool dropPending = false;
+        int cooldown = 0;
+
+        void planPlacement() {
+            rotations = std::uniform_int_distribution<>(0, 3)(rng);
+            shiftX = std::uniform_int_distribution<>(-3, 3)(rng);
+            shiftZ = std::uniform_int_distribution<>(-3, 3)(rng);
+            dropPending = true;
+        }
+
+    public:
+        DemoPlayer(unsigned seed): rng(seed) {}
+
+        // Called once per simulation tick before Game::update
+        void play(Game& game) {
+            GameEvent event;
+            while (events.poll(game.getEvents(), event)) {
+                if (event.type == GameEventType::PieceSpawned) {
+                    planPlacement();
+                }
+            }
+            if (!dropPending || --cooldown > 0) return;
+            cooldown = TICKS_PER_STEP;
+
+            if (rotations > 0) {
+                game.rotateTetromino(90.0f, glm::vec3(0, 1, 0));
+                rotations--;
+            } else if (shiftX != 0) {
+                game.moveTetromino(glm::vec3(shiftX > 0 ? 1 : -1, 0, 0));
+                shiftX += shiftX > 0 ? -1 : 1;
+            } else if (shiftZ != 0) {
+                game.moveTetromino(glm::vec3(0, 0, shiftZ > 0 ? 1 : -1));
+                shiftZ += shiftZ > 0 ? -1 : 1;
+            } else {
+                game.moveTetrominoToProjectedPosition();
+                dropPending = false;
+            }
+        }
+};
+
+#endif
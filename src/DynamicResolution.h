@@ -0,0 +1,198 @@
+#ifndef DYNAMICRESOLUTION_H
+#define DYNAMICRESOLUTION_H
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+// Renders the 3D scene into an offscreen framebuffer whose size follows a frame-time
+// budget, then stretches it over the window. On software rasterizers such as llvmpipe
+// the cost of the scene grows with its pixel count, so shrinking the render size holds
+// the frame rate when the board fills up. Text drawn after endScene() stays at the
+// native resolution.
+//
+// The scene cost is measured with GL_TIME_ELAPSED queries, read back a few frames later
+// without waiting. Only measurements of the current scale count, so a change is judged
+// on its own frames. The scale drops quickly when the smoothed cost exceeds the budget
+// and grows back slowly once it stays well below it, so it does not oscillate.
+class DynamicResolution {
+    private:
+        static const int QUERY_COUNT = 4;
+        const float MIN_SCALE = 0.4f;
+        const float MAX_SCALE = 1.0f;
+        const float SCALE_STEP = 0.05f;
+        const float GROW_BELOW = 0.7f;  // Of the budget, before growing
+        const int FRAMES_TO_SHRINK = 3;
+        const int FRAMES_TO_GROW = 60;
+        const float SMOOTHING = 0.2f;
+
+        struct TimerSlot {
+            GLuint query = 0;
+            bool pending = false;
+            float scale = 0.0f;
+        };
+
+        int windowWidth = 0, windowHeight = 0;
+        int renderWidth = 0, renderHeight = 0;
+        GLuint framebuffer = 0, colorTexture = 0, depthBuffer = 0;
+        bool complete = false;
+
+        float budgetMs;
+        float scale = 1.0f;
+        float sceneMs = 0.0f; // Smoothed cost of the scene at the current scale, 0 until measured
+        int overBudgetFrames = 0;
+        int underBudgetFrames = 0;
+        uint64_t scaleChanges = 0;
+
+        std::array<TimerSlot, QUERY_COUNT> timers;
+        int nextTimer = 0;
+        int oldestTimer = 0;
+        bool timing = false;
+
+        void setScale(float newScale) {
+            newScale = std::min(MAX_SCALE, std::max(MIN_SCALE, newScale));
+            if (newScale == scale) return;
+            scale = newScale;
+            renderWidth = std::max(1, static_cast<int>(std::lround(windowWidth * scale)));
+            renderHeight = std::max(1, static_cast<int>(std::lround(windowHeight * scale)));
+            sceneMs = 0.0f;
+            overBudgetFrames = 0;
+            underBudgetFrames = 0;
+            scaleChanges++;
+        }
+
+        void onMeasured(float ms) {
+            sceneMs = sceneMs == 0.0f ? ms : sceneMs + SMOOTHING * (ms - sceneMs);
+            overBudgetFrames = sceneMs > budgetMs ? overBudgetFrames + 1 : 0;
+            underBudgetFrames = sceneMs < budgetMs * GROW_BELOW ? underBudgetFrames + 1 : 0;
+            if (overBudgetFrames >= FRAMES_TO_SHRINK) {
+                // The cost follows the pixel count, the square of the scale; aim a little under the budget
+                setScale(std::min(scale - SCALE_STEP, scale * std::sqrt(budgetMs * 0.9f / sceneMs)));
+            } else if (underBudgetFrames >= FRAMES_TO_GROW) {
+                setScale(scale + SCALE_STEP);
+            }
+        }
+
+        // Reads the finished queries in order, without waiting for the others
+        void collectTimers() {
+            while (timers[oldestTimer].pending) {
+                TimerSlot& slot = timers[oldestTimer];
+                GLint available = 0;
+                glGetQueryObjectiv(slot.query, GL_QUERY_RESULT_AVAILABLE, &available);
+                if (!available) return;
+                GLuint64 nanoseconds = 0;
+                glGetQueryObjectui64v(slot.query, GL_QUERY_RESULT, &nanoseconds);
+                slot.pending = false;
+                oldestTimer = (oldestTimer + 1) % QUERY_COUNT;
+                if (slot.scale == scale) {
+                    onMeasured(static_cast<float>(nanoseconds) * 1e-6f);
+                }
+            }
+        }
+
+        void releaseTargets() {
+            if (framebuffer) glDeleteFramebuffers(1, &framebuffer);
+            if (colorTexture) glDeleteTextures(1, &colorTexture);
+            if (depthBuffer) glDeleteRenderbuffers(1, &depthBuffer);
+            framebuffer = colorTexture = depthBuffer = 0;
+            complete = false;
+        }
+
+    public:
+        // budgetMs is the GPU time the scene may take per frame
+        DynamicResolution(int width, int height, float budgetMs): budgetMs(budgetMs) {
+            for (TimerSlot& slot : timers) {
+                glGenQueries(1, &slot.query);
+            }
+            resize(width, height);
+        }
+
+        DynamicResolution(const DynamicResolution&) = delete;
+        DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+        // The targets are allocated at the window size once; smaller scales render into a corner of them
+        void resize(int width, int height) {
+            if (width <= 0 || height <= 0 || (width == windowWidth && height == windowHeight)) return;
+            releaseTargets();
+            windowWidth = width;
+            windowHeight = height;
+            renderWidth = std::max(1, static_cast<int>(std::lround(windowWidth * scale)));
+            renderHeight = std::max(1, static_cast<int>(std::lround(windowHeight * scale)));
+
+            glGenTextures(1, &colorTexture);
+            glBindTexture(GL_TEXTURE_2D, colorTexture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            glGenRenderbuffers(1, &depthBuffer);
+            glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+            glGenFramebuffers(1, &framebuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+            complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            if (!complete) {
+                std::cerr << "[Error] Offscreen framebuffer incomplete, rendering at the native resolution" << std::endl;
+                releaseTargets();
+            }
+        }
+
+        // Everything drawn until endScene() goes to the offscreen framebuffer at the current scale
+        void beginScene() {
+            if (!complete) return;
+            collectTimers();
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glViewport(0, 0, renderWidth, renderHeight);
+            timing = !timers[nextTimer].pending;
+            if (timing) {
+                glBeginQuery(GL_TIME_ELAPSED, timers[nextTimer].query);
+            }
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
+
+        // Stretches the scene over the window and goes back to drawing on it
+        void endScene() {
+            if (!complete) return;
+            if (timing) {
+                glEndQuery(GL_TIME_ELAPSED);
+                timers[nextTimer].pending = true;
+                timers[nextTimer].scale = scale;
+                nextTimer = (nextTimer + 1) % QUERY_COUNT;
+            }
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, windowWidth, windowHeight);
+        }
+
+        // Releases the GL objects; needs the context
+        void cleanUp() {
+            releaseTargets();
+            for (TimerSlot& slot : timers) {
+                if (slot.query) {
+                    glDeleteQueries(1, &slot.query);
+                    slot.query = 0;
+                }
+                slot.pending = false;
+            }
+        }
+
+        float getScale() const { return scale; }
+        int getRenderWidth() const { return renderWidth; }
+        int getRenderHeight() const { return renderHeight; }
+        float getSceneMs() const { return sceneMs; }
+        float getBudgetMs() const { return budgetMs; }
+        uint64_t getScaleChanges() const { return scaleChanges; }
+};
+
+#endif
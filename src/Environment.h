@@ -0,0 +1,103 @@
+#ifndef ENVIRONMENT_H
+#define ENVIRONMENT_H
+
+#include "Game.h"
+#include <cstdint>
+#include <memory>
+
+// Agent-facing wrapper of a Game: discrete actions, fixed step length, reward
+// and observations written straight into buffers owned by the caller.
+enum class EnvAction : int {
+    Idle,
+    Down,
+    Left,
+    Right,
+    Back,
+    Forward,
+    RotateX,
+    RotateY,
+    RotateZ,
+    HardDrop,
+    Count
+};
+
+// One discrete action on the game, for agents and versus peers alike
+inline void applyAction(Game& game, EnvAction action) {
+    switch (action) {
+        case EnvAction::Down: game.moveTetromino(glm::vec3(0, -1, 0)); break;
+        case EnvAction::Left: game.moveTetromino(glm::vec3(-1, 0, 0)); break;
+        case EnvAction::Right: game.moveTetromino(glm::vec3(1, 0, 0)); break;
+        case EnvAction::Back: game.moveTetromino(glm::vec3(0, 0, -1)); break;
+        case EnvAction::Forward: game.moveTetromino(glm::vec3(0, 0, 1)); break;
+        case EnvAction::RotateX: game.rotateTetromino(90.0f, glm::vec3(1, 0, 0)); break;
+        case EnvAction::RotateY: game.rotateTetromino(90.0f, glm::vec3(0, 1, 0)); break;
+        case EnvAction::RotateZ: game.rotateTetromino(90.0f, glm::vec3(0, 0, 1)); break;
+        case EnvAction::HardDrop: game.moveTetrominoToProjectedPosition(); break;
+        default: break;
+    }
+}
+
+class Environment {
+    private:
+        std::unique_ptr<Game> game;
+        int width, height, depth;
+        float stepSeconds;
+        unsigned seed = 0;
+        unsigned episode = 0;
+
+    public:
+        // stepSeconds is the simulated time of one step, gravity included
+        Environment(int width, int height, int depth, float stepSeconds)
+            : game(new Game(width, height, depth, 0)), width(width), height(height), depth(depth), stepSeconds(stepSeconds) {}
+
+        void reset(unsigned newSeed) {
+            seed = newSeed;
+            episode = 0;
+            game->start(seed);
+        }
+
+        // Applies the action and advances the game by one step. Returns the score gained.
+        // A finished game restarts right away with a seed derived from the reset seed.
+        float step(int action, bool& done) {
+            int scoreBefore = game->getScore();
+            if (action > 0 && action < static_cast<int>(EnvAction::Count)) {
+                applyAction(*game, static_cast<EnvAction>(action));
+            }
+            game->update(stepSeconds);
+            float reward = static_cast<float>(game->getScore() - scoreBefore);
+
+            done = !game->getIsRunning();
+            if (done) {
+                episode++;
+                game->start(seed + episode * 0x9e3779b9u);
+            }
+            return reward;
+        }
+
+        // 0/1 per cell, layer-major like the grid: (y * depth + z) * width + x
+        void writeOccupancy(uint8_t* out) const {
+            game->getGrid().writeOccupancy(out);
+        }
+
+        // Per column (z * width + x): index of the highest occupied layer plus one, 0 when empty
+        void writeHeightmap(uint8_t* out) const {
+            game->getGrid().writeColumnHeights(out);
+        }
+
+        // x, y, z of the four blocks of the falling piece
+        void writePiece(int8_t* out) const {
+            const std::vector<Block>& blocks = game->getCurrentTetromino().getBlocks();
+            for (size_t i = 0; i < 4; ++i) {
+                glm::vec3 pos = i < blocks.size() ? blocks[i].getPosition() : glm::vec3(-1, -1, -1);
+                out[i * 3 + 0] = static_cast<int8_t>(pos.x);
+                out[i * 3 + 1] = static_cast<int8_t>(pos.y);
+                out[i * 3 + 2] = static_cast<int8_t>(pos.z);
+            }
+        }
+
+        const Game& getGame() const {
+            return *game;
+        }
+};
+
+#endif
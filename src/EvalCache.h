@@ -0,0 +1,226 @@
+#ifndef EVALCACHE_H
+#define EVALCACHE_H
+
+#include "Game.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Placement chosen for a position: rotations applied to the spawned piece (around Z first,
+// then around Y), then the min x/z corner of its cells once dropped
+struct Placement {
+    uint8_t rotationsZ = 0, rotationsY = 0;
+    uint8_t x = 0, z = 0;
+};
+
+struct Evaluation {
+    float score = 0.0f;
+    Placement placement;
+};
+
+// Layout of the cache file: CacheHeader | slot 0 | ... | slot capacity-1
+namespace evalcache {
+
+const uint32_t MAGIC = 0x54334543; // "T3EC"
+const uint32_t FORMAT_VERSION = 1;
+const int MAX_PROBES = 32;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the evaluation cache needs lock-free 64-bit atomics");
+
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t formatVersion;
+    uint32_t rulesVersion;     // Game::RULES_VERSION of the run that filled it
+    uint32_t evaluatorVersion; // Version of the scoring heuristic, given by the bot
+    uint32_t width, height, depth;
+    uint32_t reserved;
+    uint64_t capacity;         // Slots, a power of two
+    std::atomic<uint64_t> entries;
+    uint8_t padding[16];
+};
+
+// key is a state hash, 0 while free. value is 0 until the entry is written, so a
+// reader racing an insert sees a miss rather than half an entry.
+struct CacheSlot {
+    std::atomic<uint64_t> key;
+    std::atomic<uint64_t> value;
+};
+
+static_assert(sizeof(CacheHeader) == 64, "the slots start on a cache line");
+
+const uint64_t VALID = 1ull << 63;
+
+inline uint64_t pack(const Evaluation& evaluation) {
+    uint32_t scoreBits;
+    std::memcpy(&scoreBits, &evaluation.score, sizeof(scoreBits));
+    const Placement& p = evaluation.placement;
+    return VALID | (static_cast<uint64_t>(p.rotationsZ & 3) << 58) | (static_cast<uint64_t>(p.rotationsY & 3) << 56)
+         | (static_cast<uint64_t>(p.z) << 40) | (static_cast<uint64_t>(p.x) << 32) | scoreBits;
+}
+
+inline Evaluation unpack(uint64_t value) {
+    Evaluation evaluation;
+    uint32_t scoreBits = static_cast<uint32_t>(value);
+    std::memcpy(&evaluation.score, &scoreBits, sizeof(scoreBits));
+    evaluation.placement.rotationsZ = static_cast<uint8_t>((value >> 58) & 3);
+    evaluation.placement.rotationsY = static_cast<uint8_t>((value >> 56) & 3);
+    evaluation.placement.z = static_cast<uint8_t>(value >> 40);
+    evaluation.placement.x = static_cast<uint8_t>(value >> 32);
+    return evaluation;
+}
+
+}
+
+// Persistent evaluations keyed by Game::getStateHash, shared by every thread of a run and
+// by the runs that follow. The table lives in a memory-mapped file and is open-addressed
+// with linear probing; an insert claims a free slot with a compare-and-swap on its key,
+// so there is no lock anywhere. Entries are never removed: when the probe window of a
+// position is full, its evaluation is just not stored.
+//
+// The file is reset when it was filled under other game rules (Game::RULES_VERSION),
+// another heuristic (evaluatorVersion), board size or capacity.
+class EvalCache {
+    private:
+        void* memory = MAP_FAILED;
+        size_t mappedSize = 0;
+        evalcache::CacheHeader* header = nullptr;
+        evalcache::CacheSlot* slots = nullptr;
+        uint64_t mask = 0;
+        bool warm = false;
+
+        static bool matches(const evalcache::CacheHeader& found, const evalcache::CacheHeader& expected) {
+            return found.magic == evalcache::MAGIC && found.formatVersion == expected.formatVersion
+                && found.rulesVersion == expected.rulesVersion && found.evaluatorVersion == expected.evaluatorVersion
+                && found.width == expected.width && found.height == expected.height && found.depth == expected.depth
+                && found.capacity == expected.capacity;
+        }
+
+        // Key 0 marks a free slot
+        static uint64_t slotKey(uint64_t stateHash) {
+            return stateHash ? stateHash : 1;
+        }
+
+    public:
+        // capacity is rounded up to a power of two; 16 bytes per slot
+        EvalCache(const std::string& path, int width, int height, int depth, uint32_t evaluatorVersion, uint64_t capacity = 1ull << 22) {
+            uint64_t slotCount = 1;
+            while (slotCount < capacity) {
+                slotCount <<= 1;
+            }
+            mask = slotCount - 1;
+            mappedSize = sizeof(evalcache::CacheHeader) + slotCount * sizeof(evalcache::CacheSlot);
+
+            evalcache::CacheHeader expected = {};
+            expected.formatVersion = evalcache::FORMAT_VERSION;
+            expected.rulesVersion = Game::RULES_VERSION;
+            expected.evaluatorVersion = evaluatorVersion;
+            expected.width = width;
+            expected.height = height;
+            expected.depth = depth;
+            expected.capacity = slotCount;
+
+            int fd = open(path.c_str(), O_CREAT | O_RDWR, 0644);
+            if (fd < 0) {
+                std::cerr << "[Error] Could not open the evaluation cache " << path << std::endl;
+                return;
+            }
+            evalcache::CacheHeader found = {};
+            struct stat status;
+            warm = fstat(fd, &status) == 0 && static_cast<size_t>(status.st_size) == mappedSize
+                && pread(fd, &found, sizeof(found), 0) == static_cast<ssize_t>(sizeof(found)) && matches(found, expected);
+            // Truncating to 0 first drops the stale entries without writing the whole file
+            if (!warm && (ftruncate(fd, 0) != 0 || ftruncate(fd, mappedSize) != 0)) {
+                std::cerr << "[Error] Could not size the evaluation cache " << path << std::endl;
+                close(fd);
+                return;
+            }
+            memory = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (memory == MAP_FAILED) {
+                std::cerr << "[Error] Could not map the evaluation cache " << path << std::endl;
+                return;
+            }
+            header = static_cast<evalcache::CacheHeader*>(memory);
+            slots = reinterpret_cast<evalcache::CacheSlot*>(header + 1);
+            if (!warm) {
+                std::memcpy(static_cast<void*>(header), &expected, sizeof(expected));
+                header->magic = evalcache::MAGIC;
+            }
+        }
+
+        EvalCache(const EvalCache&) = delete;
+        EvalCache& operator=(const EvalCache&) = delete;
+
+        ~EvalCache() {
+            if (memory != MAP_FAILED) {
+                munmap(memory, mappedSize);
+            }
+        }
+
+        bool isOpen() const {
+            return header != nullptr;
+        }
+
+        // True when the file already held evaluations made under the same rules
+        bool isWarm() const {
+            return warm;
+        }
+
+        bool lookup(uint64_t stateHash, Evaluation& evaluation) const {
+            if (!header) return false;
+            uint64_t key = slotKey(stateHash);
+            for (int probe = 0; probe < evalcache::MAX_PROBES; ++probe) {
+                const evalcache::CacheSlot& slot = slots[(key + probe) & mask];
+                uint64_t found = slot.key.load(std::memory_order_acquire);
+                if (found == 0) return false;
+                if (found == key) {
+                    uint64_t value = slot.value.load(std::memory_order_acquire);
+                    if (!(value & evalcache::VALID)) return false;
+                    evaluation = evalcache::unpack(value);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Returns false when every slot of the probe window belongs to another position
+        bool insert(uint64_t stateHash, const Evaluation& evaluation) {
+            if (!header) return false;
+            uint64_t key = slotKey(stateHash);
+            uint64_t value = evalcache::pack(evaluation);
+            for (int probe = 0; probe < evalcache::MAX_PROBES; ++probe) {
+                evalcache::CacheSlot& slot = slots[(key + probe) & mask];
+                uint64_t found = slot.key.load(std::memory_order_acquire);
+                if (found == 0) {
+                    // Another thread may claim it first, possibly for the same position
+                    if (slot.key.compare_exchange_strong(found, key, std::memory_order_acq_rel)) {
+                        slot.value.store(value, std::memory_order_release);
+                        header->entries.fetch_add(1, std::memory_order_relaxed);
+                        return true;
+                    }
+                }
+                if (found == key) {
+                    // Same position evaluated twice: both results are the same
+                    slot.value.store(value, std::memory_order_release);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        uint64_t getEntries() const {
+            return header ? header->entries.load(std::memory_order_relaxed) : 0;
+        }
+
+        uint64_t getCapacity() const {
+            return header ? mask + 1 : 0;
+        }
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+
+// Bump allocator for data that only lives until the end of the frame: an
+// allocation is a pointer increment and reset(), called right after
+// glfwSwapBuffers, releases everything at once. Nothing is destroyed, so only
+// store trivially destructible data here. When full it returns nullptr rather
+// than growing, and the high-water mark tells how much a frame really needs.
+class FrameArena {
+    private:
+        std::unique_ptr<unsigned char[]> buffer;
+        size_t capacity;
+        size_t used = 0;
+        size_t highWater = 0;
+        size_t failedAllocations = 0;
+
+    public:
+        explicit FrameArena(size_t capacity = 64 * 1024): buffer(new unsigned char[capacity]), capacity(capacity) {}
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        // alignment must be a power of two
+        void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+            size_t offset = (used + alignment - 1) & ~(alignment - 1);
+            if (offset + size > capacity) {
+                failedAllocations++;
+                return nullptr;
+            }
+            used = offset + size;
+            highWater = std::max(highWater, used);
+            return buffer.get() + offset;
+        }
+
+        template <typename T>
+        T* allocateArray(size_t count) {
+            return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+        }
+
+        // printf into the arena; an empty string when the arena is full
+        const char* format(const char* pattern, ...) {
+            va_list args;
+            va_start(args, pattern);
+            va_list sizing;
+            va_copy(sizing, args);
+            int length = std::vsnprintf(nullptr, 0, pattern, sizing);
+            va_end(sizing);
+
+            char* text = length >= 0 ? allocateArray<char>(length + 1) : nullptr;
+            if (text) {
+                std::vsnprintf(text, length + 1, pattern, args);
+            }
+            va_end(args);
+            return text ? text : "";
+        }
+
+        void reset() {
+            used = 0;
+        }
+
+        size_t getUsed() const { return used; }
+        size_t getHighWater() const { return highWater; }
+        size_t getCapacity() const { return capacity; }
+        size_t getFailedAllocations() const { return failedAllocations; }
+};
+
+#endif
@@ -0,0 +1,271 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <GL/glew.h>
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records the frames shown into a video without ever making the render loop wait.
+// capture(), called before glfwSwapBuffers, starts an asynchronous glReadPixels of
+// the back buffer into one of RING_SIZE pixel buffer objects and puts a fence
+// behind it. Buffers whose fence has signalled, usually a few frames later, are
+// copied to a writer thread which flips, converts and writes them. A frame is
+// dropped, and counted, when its PBO is still in flight or the writer is behind.
+//
+// A path ending in .y4m, or "-" for stdout, gets YUV4MPEG2 (4:4:4), anything else
+// raw RGB24 frames: ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -r 60 -i PATH ...
+class FrameCapture {
+    private:
+        static const int RING_SIZE = 4;
+        static const int WRITER_BUFFERS = 6; // Frames the writer can be behind before frames drop
+
+        struct Slot {
+            GLuint buffer = 0;
+            GLsync fence = nullptr;
+        };
+
+        int width, height;
+        size_t frameBytes; // RGBA, bottom-up as glReadPixels returns it
+        int frameRate;
+        bool y4m;
+        FILE* output = nullptr;
+
+        std::array<Slot, RING_SIZE> slots;
+        int nextSlot = 0;  // Where the next readback goes
+        int oldestSlot = 0; // Oldest readback in flight
+        int inFlight = 0;
+
+        // Writer side: filled buffers go through a queue, empty ones come back to the free list
+        std::vector<std::vector<uint8_t>> buffers;
+        std::vector<int> freeBuffers;
+        std::array<int, WRITER_BUFFERS> queue;
+        int queueStart = 0, queueCount = 0;
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+        bool stopping = false;
+        std::thread writer;
+
+        uint64_t captured = 0;
+        uint64_t droppedReadback = 0;
+        uint64_t droppedWriter = 0;
+        uint64_t written = 0;
+
+        // Copies every finished readback, oldest first, so that frames stay in order
+        void collect() {
+            while (inFlight > 0) {
+                Slot& slot = slots[oldestSlot];
+                GLenum status = glClientWaitSync(slot.fence, 0, 0);
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+                glDeleteSync(slot.fence);
+                slot.fence = nullptr;
+
+                int index = -1;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!freeBuffers.empty()) {
+                        index = freeBuffers.back();
+                        freeBuffers.pop_back();
+                    }
+                }
+                if (index < 0) {
+                    droppedWriter++;
+                } else {
+                    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+                    const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes, GL_MAP_READ_BIT);
+                    if (pixels) {
+                        std::memcpy(buffers[index].data(), pixels, frameBytes);
+                        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                    }
+                    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (pixels) {
+                        queue[(queueStart + queueCount) % WRITER_BUFFERS] = index;
+                        queueCount++;
+                    } else {
+                        freeBuffers.push_back(index);
+                        droppedReadback++;
+                    }
+                }
+                wakeUp.notify_one();
+                oldestSlot = (oldestSlot + 1) % RING_SIZE;
+                inFlight--;
+            }
+        }
+
+        // BT.601 limited range, integer approximation
+        static uint8_t lumaOf(int r, int g, int b) { return static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16); }
+        static uint8_t blueDifferenceOf(int r, int g, int b) { return static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128); }
+        static uint8_t redDifferenceOf(int r, int g, int b) { return static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128); }
+
+        void writeFrame(const std::vector<uint8_t>& rgba, std::vector<uint8_t>& scratch) {
+            const size_t pixelCount = static_cast<size_t>(width) * height;
+            // Rows are flipped: GL starts at the bottom, video formats at the top
+            if (y4m) {
+                uint8_t* planeY = scratch.data();
+                uint8_t* planeU = planeY + pixelCount;
+                uint8_t* planeV = planeU + pixelCount;
+                for (int row = 0; row < height; ++row) {
+                    const uint8_t* source = rgba.data() + static_cast<size_t>(height - 1 - row) * width * 4;
+                    size_t offset = static_cast<size_t>(row) * width;
+                    for (int x = 0; x < width; ++x) {
+                        int r = source[x * 4], g = source[x * 4 + 1], b = source[x * 4 + 2];
+                        planeY[offset + x] = lumaOf(r, g, b);
+                        planeU[offset + x] = blueDifferenceOf(r, g, b);
+                        planeV[offset + x] = redDifferenceOf(r, g, b);
+                    }
+                }
+                std::fputs("FRAME\n", output);
+                std::fwrite(scratch.data(), 1, pixelCount * 3, output);
+            } else {
+                for (int row = 0; row < height; ++row) {
+                    const uint8_t* source = rgba.data() + static_cast<size_t>(height - 1 - row) * width * 4;
+                    uint8_t* target = scratch.data() + static_cast<size_t>(row) * width * 3;
+                    for (int x = 0; x < width; ++x) {
+                        target[x * 3] = source[x * 4];
+                        target[x * 3 + 1] = source[x * 4 + 1];
+                        target[x * 3 + 2] = source[x * 4 + 2];
+                    }
+                }
+                std::fwrite(scratch.data(), 1, pixelCount * 3, output);
+            }
+        }
+
+        void run() {
+            std::vector<uint8_t> scratch(static_cast<size_t>(width) * height * 3);
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                wakeUp.wait(lock, [this] { return stopping || queueCount > 0; });
+                if (queueCount == 0) break; // Stopping with nothing left to write
+                int index = queue[queueStart];
+                queueStart = (queueStart + 1) % WRITER_BUFFERS;
+                queueCount--;
+                lock.unlock();
+                writeFrame(buffers[index], scratch);
+                lock.lock();
+                freeBuffers.push_back(index);
+                written++;
+            }
+            std::fflush(output);
+        }
+
+        // Lets the writer finish the queued frames first
+        void stopWriter() {
+            if (!writer.joinable()) return;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wakeUp.notify_one();
+            writer.join();
+        }
+
+    public:
+        // width x height pixels from the lower left corner of the framebuffer
+        FrameCapture(const std::string& path, int width, int height, int frameRate = 60)
+            : width(width), height(height), frameBytes(static_cast<size_t>(width) * height * 4), frameRate(frameRate) {
+            y4m = path == "-" || (path.size() > 4 && path.compare(path.size() - 4, 4, ".y4m") == 0);
+            output = path == "-" ? stdout : std::fopen(path.c_str(), "wb");
+            if (!output) {
+                std::cerr << "[Error] Cannot open capture output " << path << std::endl;
+                return;
+            }
+            if (y4m) {
+                std::fprintf(output, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width, height, frameRate);
+            }
+
+            for (Slot& slot : slots) {
+                glGenBuffers(1, &slot.buffer);
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+                glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, nullptr, GL_STREAM_READ);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            buffers.assign(WRITER_BUFFERS, std::vector<uint8_t>(frameBytes));
+            for (int i = WRITER_BUFFERS - 1; i >= 0; --i) {
+                freeBuffers.push_back(i);
+            }
+            writer = std::thread(&FrameCapture::run, this);
+        }
+
+        FrameCapture(const FrameCapture&) = delete;
+        FrameCapture& operator=(const FrameCapture&) = delete;
+
+        ~FrameCapture() {
+            stopWriter();
+            if (output && output != stdout) {
+                std::fclose(output);
+            }
+        }
+
+        bool isOpen() const {
+            return output != nullptr;
+        }
+
+        // Whether the frames read back are width x height pixels
+        bool hasSize(int width, int height) const {
+            return this->width == width && this->height == height;
+        }
+
+        // Once per frame, after everything is drawn and before the buffers are swapped
+        void capture() {
+            if (!output || !writer.joinable()) return;
+            collect();
+            if (inFlight == RING_SIZE) {
+                droppedReadback++;
+                return;
+            }
+            Slot& slot = slots[nextSlot];
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            nextSlot = (nextSlot + 1) % RING_SIZE;
+            inFlight++;
+            captured++;
+        }
+
+        // Waits for the readbacks still in flight, writes every frame left and releases the GL
+        // objects; needs the context. Nothing is captured afterwards.
+        void cleanUp() {
+            for (int i = 0; i < inFlight; ++i) {
+                GLsync fence = slots[(oldestSlot + i) % RING_SIZE].fence;
+                glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            }
+            collect();
+            for (Slot& slot : slots) {
+                if (slot.fence) {
+                    glDeleteSync(slot.fence);
+                    slot.fence = nullptr;
+                }
+                if (slot.buffer) {
+                    glDeleteBuffers(1, &slot.buffer);
+                    slot.buffer = 0;
+                }
+            }
+            inFlight = 0;
+            stopWriter();
+            if (output) {
+                std::fflush(output);
+            }
+        }
+
+        void report() {
+            std::lock_guard<std::mutex> lock(mutex);
+            // On stderr like every diagnostic of the game, stdout may carry the video
+            std::cerr << "[Capture] " << captured << " frames read back, " << written << " written, "
+                      << droppedReadback << " dropped waiting for the GPU, " << droppedWriter << " dropped with the writer behind" << std::endl;
+        }
+
+        uint64_t getCaptured() const { return captured; }
+        uint64_t getDropped() const { return droppedReadback + droppedWriter; }
+};
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <GLFW/glfw3.h>
+#include "Metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+
+enum class PacingMode {
+    VSync,  // Let glfwSwapBuffers block on the display refresh
+    FpsCap  // No vsync, sleep until the next frame deadline
+};
+
+// Decides when the next frame starts. Screens that only change on input or at
+// animation ticks wait for events instead of redrawing as fast as possible.
+// Also runs the fixed simulation clock and keeps frame time statistics.
+class FrameScheduler {
+    private:
+        const double TICK_SECONDS = 0.016;  // Length of one simulation tick
+        const int MAX_TICKS_PER_FRAME = 5;  // Drop time rather than spiral after a long stall
+        const double REPORT_INTERVAL = 10.0;
+
+        PacingMode mode;
+        double frameInterval;
+        double nextDeadline = 0.0;
+        double simulationTime = 0.0;
+        double lastFrameStart = 0.0;
+
+        // Frame time statistics of continuously rendered frames since the last report
+        int frameCount = 0;
+        int stallCount = 0;
+        double frameTimeSum = 0.0;
+        double frameTimeMin = 0.0;
+        double frameTimeMax = 0.0;
+        double lastReport = 0.0;
+        std::string summary = "Frames: no data";
+
+        static void sleepUntil(double deadline) {
+            double remaining = deadline - glfwGetTime();
+            if (remaining > 0.0) {
+                std::this_thread::sleep_for(std::chrono::duration<double>(remaining));
+            }
+        }
+
+    public:
+        // fpsCap is only used in FpsCap mode, and as the stall reference for VSync
+        FrameScheduler(PacingMode mode, double fpsCap = 60.0): mode(mode), frameInterval(1.0 / fpsCap) {}
+
+        // Must be called once the GL context is current
+        void configure() {
+            glfwSwapInterval(mode == PacingMode::VSync ? 1 : 0);
+            lastFrameStart = nextDeadline = simulationTime = lastReport = glfwGetTime();
+        }
+
+        // Called at the top of every frame, continuous is false for frames that followed an idle wait
+        void beginFrame(bool continuous) {
+            double now = glfwGetTime();
+            double frameTime = now - lastFrameStart;
+            lastFrameStart = now;
+            metrics::observe(metrics::Histogram::FrameSeconds, frameTime);
+
+            if (continuous) {
+                frameTimeMin = frameCount == 0 ? frameTime : std::min(frameTimeMin, frameTime);
+                frameTimeMax = std::max(frameTimeMax, frameTime);
+                frameTimeSum += frameTime;
+                frameCount++;
+                if (frameTime > 2.0 * frameInterval) {
+                    stallCount++;
+                }
+            }
+
+            if (now - lastReport >= REPORT_INTERVAL) {
+                lastReport = now;
+                if (frameCount > 0) {
+                    char text[160];
+                    std::snprintf(text, sizeof(text), "Frames: avg %.2f min %.2f max %.2f ms, %d stalls",
+                                  frameTimeSum / frameCount * 1000.0, frameTimeMin * 1000.0, frameTimeMax * 1000.0, stallCount);
+                    summary = text;
+                    std::cerr << "[Frames] " << summary << " over " << frameCount << " frames" << std::endl;
+                }
+                frameCount = stallCount = 0;
+                frameTimeSum = frameTimeMin = frameTimeMax = 0.0;
+            }
+        }
+
+        // Number of fixed simulation ticks due since the last call
+        int consumeTicks() {
+            double now = glfwGetTime();
+            int ticks = 0;
+            while (simulationTime + TICK_SECONDS <= now && ticks < MAX_TICKS_PER_FRAME) {
+                simulationTime += TICK_SECONDS;
+                ticks++;
+            }
+            if (ticks == MAX_TICKS_PER_FRAME) {
+                simulationTime = std::max(simulationTime, now - TICK_SECONDS);
+            }
+            return ticks;
+        }
+
+        // Forgets the simulation time accumulated while the game was not running
+        void resetTicks() {
+            simulationTime = glfwGetTime();
+        }
+
+        float getTickSeconds() const {
+            return static_cast<float>(TICK_SECONDS);
+        }
+
+        // Replaces glfwPollEvents after the swap. When animationInterval is positive the
+        // current screen is idle: sleep until an input event or the next animation tick.
+        void waitForNextFrame(double animationInterval = 0.0) {
+            if (animationInterval > 0.0) {
+                glfwWaitEventsTimeout(animationInterval);
+                nextDeadline = glfwGetTime();
+                return;
+            }
+
+            if (mode == PacingMode::FpsCap) {
+                nextDeadline += frameInterval;
+                double now = glfwGetTime();
+                if (nextDeadline < now - frameInterval) {
+                    nextDeadline = now; // Too late already, start a new schedule instead of catching up
+                }
+                sleepUntil(nextDeadline);
+            }
+            glfwPollEvents();
+        }
+
+        // Last periodic summary, for the debug overlay
+        const std::string& getSummary() const {
+            return summary;
+        }
+};
+
+#endif
@@ -2,37 +2,61 @@
 #define GAME_H
 
 #include "Grid.h"
+#include "GameEvents.h"
+#include "Trace.h"
 #include <random>
 
 class Game{
     private:
 
         Grid grid;
+        Grid::Storage storage;
         Tetromino currentTetromino;
         Tetromino nextTetromino;
+        Tetromino projectedTetromino; // Where the current piece would land, kept up to date for the renderers
+        Tetromino rotationBackup;     // Storage reused by every rotation attempt
+        Tetromino lockedTetromino;    // Last piece locked, for the consumers of PieceLocked
         bool isRunning;
         int score;
         int level;
         int linesCleared;
         int linesClearedTotal;
-        float fallSpeed;
+        float gravity;          // Cells fallen per tick of 1/60 s, fractions accumulate across updates
+        float gravityProgress;  // Part of a cell fallen since the last whole cell
+        float gravityOverride = -1.0f;
+        float lockTimer;        // Time the piece has been resting on the stack
+        int lockResets;
         int WIDTH = 4;
         int HEIGHT = 16;
         int DEPTH = 4;
 
+        int currentShape;
         int nextShape;
 
+        // Only source of randomness of the game, so a seed replays a whole game
+        std::mt19937 rng;
+
+        GameEventBuffer events;
+
         const int LINES_PER_LEVEL = 10;
         const float SPEED_INCREMENT = 0.1f;
         const glm::vec3 POSITION_NEW_TETROMINO = glm::vec3(WIDTH/2, HEIGHT, DEPTH/2);
         const glm::vec3 POSITION_NEXT_TETROMINO = glm::vec3(WIDTH + 3, HEIGHT/2, 0);
         const float INITIAL_FALL_SPEED = 0.8f;
+        const float TICKS_PER_SECOND = 60.0f;
+        const float MAX_GRAVITY = 20.0f; // 20G: the piece lands on the update it starts falling
+        const float LOCK_DELAY = 0.5f;
+        const int MAX_LOCK_RESETS = 15;
+        const uint8_t GARBAGE_COLOR = 14;
 
         int setShape(){
-            std::random_device rd;
-            std::mt19937 gen(rd());
             std::uniform_int_distribution<> dist(0, 6);
-            return dist(gen);
+            return dist(rng);
+        }
+
+        uint8_t randomColor(){
+            std::uniform_int_distribution<> dist(1, palette::SIZE - 1);
+            return static_cast<uint8_t>(dist(rng));
         }
 
         void checkPositionTetromino(Tetromino& tetromino){
@@ -56,24 +80,115 @@ class Game{
             }
         }
 
-        Tetromino calculateProjection(const Tetromino& tetromino) const {
-            Tetromino projectedTetromino = tetromino;
+        // Called whenever the current piece moves sideways, rotates or spawns. Copying into the
+        // existing piece reuses its storage, so this never allocates.
+        void updateProjection() {
+            TRACE_SCOPE("Game::updateProjection");
+            projectedTetromino = currentTetromino;
+            projectedTetromino.move(glm::vec3(0, -grid.dropDistance(currentTetromino), 0));
+        }
+
+        // Seconds per cell of the original fall speed, as cells per tick so that it no longer depends on the frame rate
+        float levelGravity() const {
+            float secondsPerCell = std::max(INITIAL_FALL_SPEED - ((INITIAL_FALL_SPEED / 15) * level), 0.01f);
+            return std::min(1.0f / (secondsPerCell * TICKS_PER_SECOND), MAX_GRAVITY);
+        }
 
-            while (!grid.checkCollision(projectedTetromino)){
-                projectedTetromino.move(glm::vec3(0, -1, 0));
+        // Moving or rotating a resting piece restarts its lock delay, a limited number of times per piece
+        void resetLockDelay(){
+            if (lockTimer > 0.0f && lockResets < MAX_LOCK_RESETS){
+                lockTimer = 0.0f;
+                lockResets++;
             }
+        }
 
-            projectedTetromino.move(glm::vec3(0, 1, 0));
+        void spawnTetromino(int shape, uint8_t colorIndex){
+            currentShape = shape;
+            currentTetromino.reset(POSITION_NEW_TETROMINO, shape, colorIndex);
+            checkPositionTetromino(currentTetromino);
+            updateProjection();
+            gravityProgress = 0.0f;
+            lockTimer = 0.0f;
+            lockResets = 0;
+        }
 
-            return projectedTetromino;
+        void lockTetromino(){
+            grid.placeTetromino(currentTetromino);
+            lockedTetromino = currentTetromino;
+            events.publish(GameEventType::PieceLocked);
+
+            std::array<int, 4> clearedLayers;
+            linesCleared += grid.clearLines(&clearedLayers);
+            if (linesCleared == 1){
+                score += 40 * (level + 1);
+            } else if (linesCleared == 2){
+                score += 100 * (level + 1);
+            } else if (linesCleared == 3){
+                score += 300 * (level + 1);
+            } else if (linesCleared == 4){
+                score += 1200 * (level + 1);
+            }
+            if (linesCleared > 0){
+                GameEvent cleared;
+                cleared.type = GameEventType::LayersCleared;
+                cleared.layerCount = static_cast<uint8_t>(std::min(linesCleared, 4));
+                for (int i = 0; i < cleared.layerCount; ++i){
+                    cleared.layers[i] = static_cast<int16_t>(clearedLayers[i]);
+                }
+                cleared.value = score;
+                events.publish(cleared);
+                metrics::increment(static_cast<metrics::Counter>(static_cast<int>(metrics::Counter::LineClears1) + cleared.layerCount - 1));
+            }
+            linesClearedTotal += linesCleared;
+            linesCleared = 0;
+            int previousLevel = level;
+            level = linesClearedTotal/LINES_PER_LEVEL; ;
+            if (level != previousLevel){
+                events.publish(GameEventType::LevelUp, level);
+            }
+
+            // Set up the next Tetromino
+            int shape = nextShape;
+            spawnTetromino(shape, nextTetromino.getColorIndex());
+            nextShape = setShape();
+            nextTetromino.reset(POSITION_NEXT_TETROMINO, nextShape, randomColor());
+            events.publish(GameEventType::PieceSpawned, shape);
+            metrics::increment(metrics::Counter::PiecesSpawned);
+
+            // Check if the game is over
+            isRunning = !checkGameOver(currentTetromino);
+            if (!isRunning){
+                events.publish(GameEventType::GameOver, score);
+            }
         }
 
-        bool checkGameOver(Tetromino currentTetromino) const{
+        bool checkGameOver(const Tetromino& currentTetromino) const{
             return grid.checkCollision(currentTetromino);
         }
 
     public:
-        Game(int width, int height, int depth): grid(width, height, depth), WIDTH(width) , HEIGHT(height), DEPTH(depth){
+        // Bump with any change to how pieces spawn, lock, clear and score: evaluations persisted
+        // under other rules (EvalCache) are then discarded
+        static const uint32_t RULES_VERSION = 1;
+
+        // Everything the simulation depends on, for rollback: restoring a snapshot and replaying
+        // the same inputs gives the same game. Events are not part of it, a replay publishes again.
+        // Saving into the same Snapshot again reuses its storage.
+        struct Snapshot {
+            Grid grid;
+            Tetromino currentTetromino, nextTetromino, projectedTetromino;
+            bool isRunning;
+            int score, level, linesCleared, linesClearedTotal;
+            float gravity, gravityProgress, gravityOverride, lockTimer;
+            int lockResets;
+            int currentShape, nextShape;
+            std::mt19937 rng;
+        };
+
+        Game(int width, int height, int depth): Game(width, height, depth, std::random_device()()) {}
+
+        // Same seed, same inputs and same update steps give the same game
+        Game(int width, int height, int depth, unsigned seed, Grid::Storage storage = Grid::Storage::Auto): grid(width, height, depth, storage), storage(storage), WIDTH(width) , HEIGHT(height), DEPTH(depth), rng(seed){
             start();
         }
 
@@ -83,78 +198,151 @@ class Game{
             level = 0;
             linesCleared = 0;
             linesClearedTotal = 0;
-            fallSpeed = INITIAL_FALL_SPEED;
-            grid = Grid(WIDTH, HEIGHT, DEPTH);
+            gravity = levelGravity();
+            grid = Grid(WIDTH, HEIGHT, DEPTH, storage);
             nextShape = setShape();
-            currentTetromino = Tetromino(POSITION_NEW_TETROMINO, setShape());
-            checkPositionTetromino(currentTetromino);
-            nextTetromino = Tetromino(POSITION_NEXT_TETROMINO, nextShape);
+            int shape = setShape();
+            spawnTetromino(shape, randomColor());
+            nextTetromino.reset(POSITION_NEXT_TETROMINO, nextShape, randomColor());
+            events.publish(GameEventType::GameStarted);
+            events.publish(GameEventType::PieceSpawned, shape);
+            metrics::increment(metrics::Counter::PiecesSpawned);
         }
 
+        // Restarts with a new seed, e.g. to replay a recorded game
+        void start(unsigned seed){
+            rng.seed(seed);
+            start();
+        }
 
+        // Gravity moves the piece by whole cells, as many as the elapsed time allows, straight to
+        // its landing cell at high gravity. A resting piece locks after LOCK_DELAY seconds.
         void update(float deltaTime) {
-            static float accumulatedTime = 0.0f;
-            accumulatedTime += deltaTime;
-
-            fallSpeed = std::max( INITIAL_FALL_SPEED - ((INITIAL_FALL_SPEED / 15) * level), 0.01f);
-
-            if (accumulatedTime >= fallSpeed) {
-                // Move the current Tetromino down
-                currentTetromino.move(glm::vec3(0, -1, 0));
-                
-                // Place the Tetromino and clear lines if it collides
-                if (grid.checkCollision(currentTetromino)) {
-                    currentTetromino.move(glm::vec3(0, 1, 0)); // Undo the move
-                    grid.placeTetromino(currentTetromino);
-                    linesCleared += grid.clearLines();
-                    if (linesCleared == 1){
-                        score += 40 * (level + 1);
-                    } else if (linesCleared == 2){
-                        score += 100 * (level + 1);
-                    } else if (linesCleared == 3){
-                        score += 300 * (level + 1);
-                    } else if (linesCleared == 4){
-                        score += 1200 * (level + 1);
-                    }
-                    linesClearedTotal += linesCleared;
-                    linesCleared = 0;
-                    level = linesClearedTotal/LINES_PER_LEVEL; ;
-
-                    // Set up the next Tetromino
-                    currentTetromino = Tetromino(POSITION_NEW_TETROMINO, nextShape,nextTetromino.getColor());
-                    checkPositionTetromino(currentTetromino);
-                    nextShape = setShape();
-                    nextTetromino = Tetromino(POSITION_NEXT_TETROMINO, nextShape);
-
-                    // Check if the game is over
-                    isRunning = !checkGameOver(currentTetromino);
+            metrics::ScopedTimer timer(metrics::Histogram::UpdateSeconds);
+            TRACE_SCOPE("Game::update");
+            gravity = gravityOverride >= 0.0f ? std::min(gravityOverride, MAX_GRAVITY) : levelGravity();
+
+            int distance = grid.dropDistance(currentTetromino);
+            if (distance > 0) {
+                lockTimer = 0.0f;
+                gravityProgress += gravity * deltaTime * TICKS_PER_SECOND;
+                int cells = std::min(static_cast<int>(gravityProgress), distance);
+                if (cells > 0) {
+                    currentTetromino.move(glm::vec3(0, -cells, 0));
+                    // Landing drops the rest of the fall, the lock delay starts from the next update
+                    gravityProgress = cells == distance ? 0.0f : gravityProgress - cells;
+                    events.publish(GameEventType::PieceMoved);
+                }
+            } else {
+                lockTimer += deltaTime;
+                if (lockTimer >= LOCK_DELAY) {
+                    lockTetromino();
                 }
+            }
+        }
+
+        void save(Snapshot& snapshot) const {
+            snapshot.grid = grid;
+            snapshot.currentTetromino = currentTetromino;
+            snapshot.nextTetromino = nextTetromino;
+            snapshot.projectedTetromino = projectedTetromino;
+            snapshot.isRunning = isRunning;
+            snapshot.score = score;
+            snapshot.level = level;
+            snapshot.linesCleared = linesCleared;
+            snapshot.linesClearedTotal = linesClearedTotal;
+            snapshot.gravity = gravity;
+            snapshot.gravityProgress = gravityProgress;
+            snapshot.gravityOverride = gravityOverride;
+            snapshot.lockTimer = lockTimer;
+            snapshot.lockResets = lockResets;
+            snapshot.currentShape = currentShape;
+            snapshot.nextShape = nextShape;
+            snapshot.rng = rng;
+        }
+
+        // The snapshot must come from a game of the same size
+        void restore(const Snapshot& snapshot) {
+            grid = snapshot.grid;
+            currentTetromino = snapshot.currentTetromino;
+            nextTetromino = snapshot.nextTetromino;
+            projectedTetromino = snapshot.projectedTetromino;
+            isRunning = snapshot.isRunning;
+            score = snapshot.score;
+            level = snapshot.level;
+            linesCleared = snapshot.linesCleared;
+            linesClearedTotal = snapshot.linesClearedTotal;
+            gravity = snapshot.gravity;
+            gravityProgress = snapshot.gravityProgress;
+            gravityOverride = snapshot.gravityOverride;
+            lockTimer = snapshot.lockTimer;
+            lockResets = snapshot.lockResets;
+            currentShape = snapshot.currentShape;
+            nextShape = snapshot.nextShape;
+            rng = snapshot.rng;
+        }
 
-                accumulatedTime = 0.0f;
+        // Garbage sent by a versus opponent: count full layers with one hole at (holeX, holeZ) pushed
+        // under the stack. The falling piece rises with the stack when it would overlap it; the
+        // game ends when blocks leave the top of the board or the piece cannot get out of the way.
+        void addGarbage(int count, int holeX, int holeZ){
+            if (!isRunning || count <= 0) return;
+            bool kept = grid.insertGarbageLayers(count, holeX, holeZ, GARBAGE_COLOR);
+            for (int lift = 0; lift < count && grid.checkCollision(currentTetromino); ++lift){
+                currentTetromino.move(glm::vec3(0, 1, 0));
+            }
+            updateProjection();
+            isRunning = kept && !checkGameOver(currentTetromino);
+            if (!isRunning){
+                events.publish(GameEventType::GameOver, score);
             }
         }
 
-        Tetromino getProjectedTetromino(const Tetromino& tetromino) const {
-            return calculateProjection(tetromino);
+        // Landing position of the current Tetromino
+        const Tetromino& getProjectedTetromino() const {
+            return projectedTetromino;
         }
 
-        void moveTetromino(const glm::vec3& direction){
+        // Returns true if the Tetromino actually moved
+        bool moveTetromino(const glm::vec3& direction){
             currentTetromino.move(glm::vec3(direction.x, direction.y, direction.z));
             if (grid.checkCollision(currentTetromino)){
                 currentTetromino.move(glm::vec3(-direction.x, -direction.y, -direction.z));
+                return false;
+            }
+            if (direction.x != 0 || direction.z != 0){
+                updateProjection();
             }
+            resetLockDelay();
+            events.publish(GameEventType::PieceMoved);
+            return true;
         }
 
-        void rotateTetromino(float angle, const glm::vec3& axis){
+        // Returns true if the rotation was accepted
+        bool rotateTetromino(float angle, const glm::vec3& axis){
+            rotationBackup = currentTetromino;
             currentTetromino.rotate(angle, glm::vec3(axis.x, axis.y, axis.z));
             checkPositionTetromino(currentTetromino);
             if (grid.checkCollision(currentTetromino)){
-                currentTetromino.rotate(-angle, glm::vec3(axis.x, axis.y, axis.z));
+                // Rotating back would keep the shift of checkPositionTetromino, restore the exact piece
+                currentTetromino = rotationBackup;
+                metrics::increment(metrics::Counter::RotationsRejected);
+                return false;
             }
+            updateProjection();
+            resetLockDelay();
+            events.publish(GameEventType::PieceRotated);
+            return true;
         }
 
-        void moveTetrominoToProjectedPosition(){
-            currentTetromino = calculateProjection(currentTetromino);
+        // Returns true if the Tetromino was not already resting on its projection
+        bool moveTetrominoToProjectedPosition(){
+            bool moved = projectedTetromino.getBlocks()[0].getPosition() != currentTetromino.getBlocks()[0].getPosition();
+            currentTetromino = projectedTetromino;
+            if (moved){
+                events.publish(GameEventType::PieceMoved);
+            }
+            return moved;
         }
 
         int getScore() const{
@@ -169,15 +357,15 @@ class Game{
             return isRunning;
         }
 
-        Grid getGrid() const{
+        const Grid& getGrid() const{
             return grid;
         }
 
-        Tetromino getCurrentTetromino() const{
+        const Tetromino& getCurrentTetromino() const{
             return currentTetromino;
         }
 
-        Tetromino getNextTetromino() const{
+        const Tetromino& getNextTetromino() const{
             return nextTetromino;
         }
 
@@ -185,8 +373,44 @@ class Game{
             return level;
         }
 
-        ~Game(){
-            grid.cleanUp();
+        // Cells per tick of 1/60 s applied by the last update
+        float getGravity() const{
+            return gravity;
+        }
+
+        // Fixed gravity in cells per tick, up to 20G, instead of the level curve; negative restores the curve
+        void setGravity(float cellsPerTick){
+            gravityOverride = cellsPerTick;
+        }
+
+        // Board, falling piece and next shape in one Zobrist hash, for transposition tables and
+        // replay checks. Score and timers are left out: they do not change what can be played.
+        uint64_t getStateHash() const{
+            uint64_t hash = grid.getHash() ^ zobrist::queueKey(0, nextShape);
+            for (const Block& block : currentTetromino.getBlocks()){
+                glm::vec3 pos = block.getPosition();
+                hash ^= zobrist::pieceKey(static_cast<int>(pos.x), static_cast<int>(pos.y), static_cast<int>(pos.z));
+            }
+            return hash;
+        }
+
+        // Where the piece of the last PieceLocked event came to rest. Not part of a Snapshot.
+        const Tetromino& getLastLockedTetromino() const{
+            return lockedTetromino;
+        }
+
+        // Shape ids (0-6) of the falling and the next Tetromino
+        int getCurrentShape() const{
+            return currentShape;
+        }
+
+        int getNextShape() const{
+            return nextShape;
+        }
+
+        // Typed notifications of every state change, drained with a GameEventReader
+        const GameEventBuffer& getEvents() const{
+            return events;
         }
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,83 @@
+#ifndef GAMEEVENTS_H
+#define GAMEEVENTS_H
+
+#include <array>
+#include <cstdint>
+
+enum class GameEventType : uint8_t {
+    GameStarted,
+    PieceSpawned,  // value: shape of the new piece
+    PieceMoved,
+    PieceRotated,
+    PieceLocked,
+    LayersCleared, // value: new score, layers: indices of the cleared layers
+    LevelUp,       // value: new level
+    GameOver
+};
+
+struct GameEvent {
+    GameEventType type;
+    uint8_t layerCount = 0;
+    std::array<int16_t, 4> layers{}; // A piece spans at most 4 layers, so at most 4 clear at once
+    int value = 0;
+};
+
+// Fixed-capacity broadcast buffer: the game publishes, any number of readers
+// drain it at their own pace through a GameEventReader. Never allocates.
+class GameEventBuffer {
+    private:
+        static const uint64_t CAPACITY = 256; // Must be a power of two
+
+        std::array<GameEvent, CAPACITY> events;
+        uint64_t published = 0; // Sequence number of the next event
+
+        friend class GameEventReader;
+
+    public:
+        void publish(const GameEvent& event) {
+            events[published & (CAPACITY - 1)] = event;
+            published++;
+        }
+
+        void publish(GameEventType type, int value = 0) {
+            GameEvent event;
+            event.type = type;
+            event.value = value;
+            publish(event);
+        }
+
+        uint64_t getPublishedCount() const {
+            return published;
+        }
+};
+
+// Cursor of one subscriber. A reader that falls more than CAPACITY events
+// behind skips to the oldest event still available and reports the overflow.
+class GameEventReader {
+    private:
+        uint64_t cursor = 0;
+        bool overflowed = false;
+
+    public:
+        bool poll(const GameEventBuffer& buffer, GameEvent& event) {
+            if (buffer.published - cursor > GameEventBuffer::CAPACITY) {
+                cursor = buffer.published - GameEventBuffer::CAPACITY;
+                overflowed = true;
+            }
+            if (cursor == buffer.published) {
+                return false;
+            }
+            event = buffer.events[cursor & (GameEventBuffer::CAPACITY - 1)];
+            cursor++;
+            return true;
+        }
+
+        // True if events were lost since the last call, consumers should then rebuild from full state
+        bool checkOverflow() {
+            bool result = overflowed;
+            overflowed = false;
+            return result;
+        }
+};
+
+#endif
@@ -2,95 +2,327 @@
 #define GRID_H
 
 #include "Tetromino.h"
+#include "GridKernels.h"
+#include "SparseBoard.h"
+#include "Zobrist.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
 
 class Grid{
     private:
-        GLuint VAO;
-        int vertexCount;
         int width, height, depth;
 
-        std::vector<std::vector<std::vector<bool>>> cells;
-        std::vector<std::vector<std::vector<glm::vec3>>> cellColors;
-
+        // Palette index of every cell, palette::EMPTY when free. Layer-major like the
+        // row masks: index (y * depth + z) * width + x, so a layer is one contiguous slab.
+        std::vector<uint8_t> cellColors;
 
         std::vector<int> lineCounters;
 
-        // Generate vertices for a 3D grid based on width, height, and depth
-        std::vector<float> generateGridVertices(int width, int height, int depth) {
-            std::vector<float> vertices;
+        // Zobrist hash of every layer's occupancy and of the whole board, see Zobrist.h. Colours
+        // are left out: they never change how the game plays.
+        std::vector<uint64_t> layerHashes;
+        uint64_t hash = 0;
+
+        // Occupancy of every (y, z) row with one bit per x, indexed y * depth + z.
+        // Mirrors the occupancy of cellColors for the batch queries, which handle a whole row per operation.
+        std::vector<uint64_t> rowMasks;
+
+        // Layer removal dedicated to this board size when it is one of TETRIS_BOARD_SIZES
+        const GridKernelTable* kernels = &gridKernelTable<0, 0, 0>();
+
+        // Huge boards keep their cells here instead of cellColors and rowMasks, which then stay empty
+        bool sparse = false;
+        SparseBoard sparseBoard;
 
-            for (int y = 0; y <= height; ++y) {
-                // Líneas horizontales
-                vertices.insert(vertices.end(), { 0, (float)y, 0, (float)width, (float)y, 0 });
-                vertices.insert(vertices.end(), { 0, (float)y, 0, 0, (float)y, (float)depth });
+        size_t cellIndex(int x, int y, int z) const {
+            return (static_cast<size_t>(y) * depth + z) * width + x;
+        }
+
+        // Marks the cell as occupied and updates the line counter and hashes of its layer, unless it already was
+        void occupyCell(int x, int y, int z, uint8_t colorIndex) {
+            if (sparse) {
+                if (!sparseBoard.set(x, y, z, colorIndex)) return;
+            } else {
+                uint8_t& cell = cellColors[cellIndex(x, y, z)];
+                if (cell != palette::EMPTY) return;
+                cell = colorIndex;
+                if (x < MAX_WIDTH) {
+                    rowMasks[y * depth + z] |= 1ull << x;
+                }
             }
+            lineCounters[y]++;
+            hash ^= zobrist::layerKey(layerHashes[y], y);
+            layerHashes[y] ^= zobrist::columnKey(x, z);
+            hash ^= zobrist::layerKey(layerHashes[y], y);
+        }
+
+        // After layers moved: only the layer hashes are combined again, no cell is read
+        void rehashLayers() {
+            hash = 0;
+            for (int y = 0; y < height; ++y) {
+                hash ^= zobrist::layerKey(layerHashes[y], y);
+            }
+        }
+
+        // Row masks for one query: on the stack for the usual board sizes, on the heap past them
+        class ScratchRows {
+            private:
+                uint64_t local[256];
+                std::vector<uint64_t> heap;
+                uint64_t* rows;
+
+            public:
+                explicit ScratchRows(size_t count)
+                    : rows(count <= 256 ? local : (heap.resize(count), heap.data())) {}
+                uint64_t& operator[](size_t i) { return rows[i]; }
+                uint64_t* data() { return rows; }
+        };
 
-            for (int z = 0; z <= depth; ++z) {
-                // Líneas verticales
-                vertices.insert(vertices.end(), { 0, 0, (float)z, 0, (float)height, (float)z });
-                vertices.insert(vertices.end(), { 0, 0, (float)z, (float)width, 0, (float)z });
+        // Batch query kernel on either storage, for grids up to MAX_WIDTH wide: the row masks
+        // drop the columns past it. The sparse board builds the few rows the footprint covers
+        // and runs the generic kernel on them.
+        void fitsAtLayer(const PieceFootprint& fp, int y, uint64_t* fitMasks) const {
+            if (!sparse) {
+                GridKernels::fitsAtLayer(getBoardView(), fp, y, fitMasks);
+                return;
             }
+            if (fp.count == 0 || y < 0 || y + fp.sizeY > height) {
+                std::fill(fitMasks, fitMasks + depth, 0);
+                return;
+            }
+            ScratchRows rows(static_cast<size_t>(fp.sizeY) * depth);
+            for (int dy = 0; dy < fp.sizeY; ++dy) {
+                for (int z = 0; z < depth; ++z) {
+                    rows[dy * depth + z] = sparseBoard.rowMask(y + dy, z);
+                }
+            }
+            BoardView layers = { width, fp.sizeY, depth, nullptr, rows.data() };
+            GridKernels::fitsAtLayer(layers, fp, 0, fitMasks);
+        }
 
-            for (int x = 0; x <= width; ++x) {
-                vertices.insert(vertices.end(), { (float)x, 0, 0, (float)x, (float)height, 0 });
-                vertices.insert(vertices.end(), { (float)x, 0, 0, (float)x, 0, (float)depth });
+        // Cell by cell, for the grids too wide for the row masks. y must not be negative.
+        bool footprintFits(const PieceFootprint& fp, int ox, int y, int oz) const {
+            for (int b = 0; b < fp.count; ++b) {
+                if (y + fp.y[b] >= height || isCellOccupied(ox + fp.x[b], y + fp.y[b], oz + fp.z[b])) return false;
             }
+            return true;
+        }
 
-            return vertices;
+        // queryFits of the grids wider than MAX_WIDTH, getFitWords() words per z row
+        void scalarFits(const PieceFootprint& fp, int y, uint64_t* fitMasks) const {
+            const int words = getFitWords();
+            std::fill(fitMasks, fitMasks + static_cast<size_t>(words) * depth, 0);
+            if (fp.count == 0 || y < 0 || y + fp.sizeY > height) return;
+            for (int oz = 0; oz + fp.sizeZ <= depth; ++oz) {
+                for (int ox = 0; ox + fp.sizeX <= width; ++ox) {
+                    if (footprintFits(fp, ox, y, oz)) {
+                        fitMasks[oz * words + ox / 64] |= 1ull << (ox % 64);
+                    }
+                }
+            }
         }
 
+        void scalarLandingLayers(const PieceFootprint& fp, int startY, int* landingLayers) const {
+            if (fp.count == 0 || startY < 0) return;
+            for (int oz = 0; oz + fp.sizeZ <= depth; ++oz) {
+                for (int ox = 0; ox + fp.sizeX <= width; ++ox) {
+                    if (!footprintFits(fp, ox, startY, oz)) continue;
+                    int y = startY;
+                    while (y > 0 && footprintFits(fp, ox, y - 1, oz)) {
+                        y--;
+                    }
+                    landingLayers[oz * width + ox] = y;
+                }
+            }
+        }
 
     public:
+        // Widest grid the row masks can represent
+        static const int MAX_WIDTH = 64;
+        // Auto storage turns sparse above this many cells, or above MAX_WIDTH columns
+        static constexpr size_t SPARSE_CELL_THRESHOLD = size_t(1) << 22;
+
+        enum class Storage { Auto, Dense, Sparse };
+
+        static bool usesSparseStorage(int width, int height, int depth, Storage storage) {
+            if (storage != Storage::Auto) return storage == Storage::Sparse;
+            return width > MAX_WIDTH || static_cast<size_t>(width) * height * depth > SPARSE_CELL_THRESHOLD;
+        }
+
         Grid(){}
-        Grid(int width, int height, int depth): width(width), height(height), depth(depth), cells(width, std::vector<std::vector<bool>>(height, std::vector<bool>(depth, false))), lineCounters(height, 0), cellColors(width, std::vector<std::vector<glm::vec3>>(height, std::vector<glm::vec3>(depth, glm::vec3(0.0f)))) {
-            std::vector<float> vertices = generateGridVertices(width, height, depth);
-            vertexCount = vertices.size() / 3;
+        Grid(int width, int height, int depth, Storage storage = Storage::Auto)
+            : width(width), height(height), depth(depth), sparse(usesSparseStorage(width, height, depth, storage)) {
+            lineCounters.assign(height, 0);
+            layerHashes.assign(height, 0);
+            if (sparse) {
+                sparseBoard = SparseBoard(width, height, depth);
+            } else {
+                cellColors.assign(static_cast<size_t>(width) * height * depth, palette::EMPTY);
+                rowMasks.assign(height * depth, 0);
+                kernels = &selectGridKernels(width, height, depth);
+            }
+        }
 
-            glGenVertexArrays(1, &VAO);
-            glBindVertexArray(VAO);
+        bool isSparse() const {
+            return sparse;
+        }
 
-            GLuint VBO;
-            glGenBuffers(1, &VBO);
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
-            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-            glEnableVertexAttribArray(0);
+        // Heap memory of the cell storage
+        size_t memoryBytes() const {
+            return sparse ? sparseBoard.memoryBytes() : cellColors.capacity() + rowMasks.capacity() * sizeof(uint64_t);
+        }
 
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-            glBindVertexArray(0);
+        // Dense storage only: a sparse grid has no flat arrays to view
+        BoardView getBoardView() const {
+            return { width, height, depth, cellColors.data(), rowMasks.data() };
+        }
+
+        // "sized", "generic" or "sparse", see GridKernels.h and SparseBoard.h
+        const char* getKernelName() const {
+            return sparse ? "sparse" : kernels->name;
         }
 
         glm::vec3 getCellColor(int x, int y, int z) const {
-            return cellColors[x][y][z];
+            return palette::color(getCellColorIndex(x, y, z));
         }
 
-        // Checks if the given Tetromino collides with the boundaries or occupied cells in the grid
-        bool checkCollision(const Tetromino& tetromino) const {
-            for (const auto& block : tetromino.getBlocks()) {
-                glm::vec3 pos = block.getPosition();
-                int x = static_cast<int>(pos.x);
-                int y = static_cast<int>(pos.y);
-                int z = static_cast<int>(pos.z);
+        uint8_t getCellColorIndex(int x, int y, int z) const {
+            return sparse ? sparseBoard.colorAt(x, y, z) : cellColors[cellIndex(x, y, z)];
+        }
 
-                // Check if the block is outside the grid boundaries
-                if (x < 0 || x >= width || y < 0 || y >= height || z < 0 || z >= depth) {
-                    return true;
+        // visit(x, y, z, colorIndex) for every occupied cell, from the bottom layer up. Empty
+        // layers are skipped, so this costs what the stack holds rather than the board volume.
+        template <typename Visitor>
+        void forEachOccupiedCell(Visitor&& visit) const {
+            if (sparse) {
+                sparseBoard.forEachOccupied(visit);
+                return;
+            }
+            for (int y = 0; y < height; ++y) {
+                if (lineCounters[y] == 0) continue;
+                const uint8_t* layer = cellColors.data() + cellIndex(0, y, 0);
+                for (int z = 0; z < depth; ++z) {
+                    for (int x = 0; x < width; ++x) {
+                        uint8_t color = layer[z * width + x];
+                        if (color != palette::EMPTY) {
+                            visit(x, y, z, color);
+                        }
+                    }
                 }
+            }
+        }
 
-                // Check if the block is colliding with an occupied cell
-                if (cells[x][y][z]) {
-                    return true;
+        // 0/1 per cell, layer-major like the colours. The dense loop runs over whole layers
+        // and vectorises; layers without blocks are only cleared.
+        void writeOccupancy(uint8_t* out) const {
+            const size_t layerSize = static_cast<size_t>(width) * depth;
+            if (sparse) {
+                std::memset(out, 0, layerSize * height);
+                sparseBoard.forEachOccupied([&](int x, int y, int z, uint8_t) {
+                    out[cellIndex(x, y, z)] = 1;
+                });
+                return;
+            }
+            for (int y = 0; y < height; ++y) {
+                uint8_t* layerOut = out + y * layerSize;
+                if (lineCounters[y] == 0) {
+                    std::memset(layerOut, 0, layerSize);
+                    continue;
+                }
+                const uint8_t* layer = cellColors.data() + y * layerSize;
+                for (size_t i = 0; i < layerSize; ++i) {
+                    layerOut[i] = layer[i] != palette::EMPTY;
                 }
             }
-            return false;
         }
 
-        void cleanUp() {
-            glDeleteVertexArrays(1, &VAO);
+        // Per column (z * width + x): index of the highest occupied layer plus one, 0 when empty
+        void writeColumnHeights(uint8_t* out) const {
+            const size_t layerSize = static_cast<size_t>(width) * depth;
+            std::memset(out, 0, layerSize);
+            if (sparse) {
+                // Cells come layer by layer from the bottom, so the last one seen in a column is the highest
+                sparseBoard.forEachOccupied([&](int x, int y, int z, uint8_t) {
+                    out[z * width + x] = static_cast<uint8_t>(y + 1);
+                });
+                return;
+            }
+            for (int y = 0; y < height; ++y) {
+                if (lineCounters[y] == 0) continue;
+                const uint8_t* layer = cellColors.data() + y * layerSize;
+                for (size_t i = 0; i < layerSize; ++i) {
+                    out[i] = layer[i] != palette::EMPTY ? static_cast<uint8_t>(y + 1) : out[i];
+                }
+            }
+        }
+
+        // Checks if the given Tetromino collides with the boundaries or occupied cells in the grid
+        bool checkCollision(const Tetromino& tetromino) const {
+            metrics::increment(metrics::Counter::CollisionChecks);
+            return sparse ? sparseBoard.collides(tetromino.getBlocks()) : GridKernels::collides(getBoardView(), tetromino.getBlocks());
+        }
+
+        // How far the Tetromino falls before landing, in one query instead of a move/checkCollision loop
+        int dropDistance(const Tetromino& tetromino) const {
+            return sparse ? sparseBoard.dropDistance(tetromino.getBlocks()) : GridKernels::dropDistance(getBoardView(), tetromino.getBlocks());
         }
 
         int getWidth() const { return width; }
         int getHeight() const { return height; }
+
+        // Zobrist hash of the occupied cells, kept up to date by every change: equal boards hash
+        // equal, whatever the moves that built them and in any process
+        uint64_t getHash() const {
+            return hash;
+        }
+
+        // The same hash computed from the cells, to check the incremental one
+        uint64_t computeHash() const {
+            std::vector<uint64_t> layers(height, 0);
+            forEachOccupiedCell([&](int x, int y, int z, uint8_t) {
+                layers[y] ^= zobrist::columnKey(x, z);
+            });
+            uint64_t result = 0;
+            for (int y = 0; y < height; ++y) {
+                result ^= zobrist::layerKey(layers[y], y);
+            }
+            return result;
+        }
+
+        // Hash the board would have with the Tetromino placed, before any line clear. A search can
+        // tell placements that lead to the same board apart from new ones without placing them.
+        uint64_t hashWith(const Tetromino& tetromino) const {
+            std::array<int, 4> layers;
+            std::array<uint64_t, 4> layerHash;
+            int count = 0;
+            for (const Block& block : tetromino.getBlocks()) {
+                glm::vec3 pos = block.getPosition();
+                int x = static_cast<int>(pos.x);
+                int y = static_cast<int>(pos.y);
+                int z = static_cast<int>(pos.z);
+                if (x < 0 || x >= width || y < 0 || y >= height || z < 0 || z >= depth || isCellOccupied(x, y, z)) continue;
+                int i = 0;
+                while (i < count && layers[i] != y) {
+                    i++;
+                }
+                if (i == count) {
+                    if (count == 4) continue;
+                    layers[count] = y;
+                    layerHash[count] = layerHashes[y];
+                    count++;
+                }
+                layerHash[i] ^= zobrist::columnKey(x, z);
+            }
+            uint64_t result = hash;
+            for (int i = 0; i < count; ++i) {
+                result ^= zobrist::layerKey(layerHashes[layers[i]], layers[i]) ^ zobrist::layerKey(layerHash[i], layers[i]);
+            }
+            return result;
+        }
         int getDepth() const { return depth; }
 
         // Places the given Tetromino onto the grid and updates the occupied cells and line counters
@@ -101,61 +333,138 @@ class Grid{
                 int y = static_cast<int>(pos.y);
                 int z = static_cast<int>(pos.z);
 
-                // Mark the cell as occupied and increment the line counter for the respective y-level
-                if (!cells[x][y][z]) {
-                    cells[x][y][z] = true;
-                    cellColors[x][y][z] = block.getColor();
-                    lineCounters[y]++;
+                occupyCell(x, y, z, block.getColorIndex());
+            }
+        }
+
+        // Pushes the whole stack up by count layers and fills the new bottom layers except for the
+        // column (holeX, holeZ), like the garbage a versus opponent sends. Returns false when
+        // blocks were pushed out of the top of the board.
+        bool insertGarbageLayers(int count, int holeX, int holeZ, uint8_t colorIndex) {
+            count = std::min(count, height);
+            if (count <= 0) return true;
+            bool kept = true;
+            for (int y = height - count; y < height; ++y) {
+                kept = kept && lineCounters[y] == 0;
+            }
+
+            if (sparse) {
+                for (int i = 0; i < count; ++i) {
+                    sparseBoard.insertBottomLayer();
                 }
+            } else {
+                const size_t layerSize = static_cast<size_t>(width) * depth;
+                std::memmove(cellColors.data() + count * layerSize, cellColors.data(), (height - count) * layerSize);
+                std::memmove(rowMasks.data() + count * depth, rowMasks.data(), (height - count) * depth * sizeof(uint64_t));
+                std::memset(cellColors.data(), palette::EMPTY, count * layerSize);
+                std::memset(rowMasks.data(), 0, count * depth * sizeof(uint64_t));
             }
+            std::rotate(lineCounters.begin(), lineCounters.end() - count, lineCounters.end());
+            std::fill(lineCounters.begin(), lineCounters.begin() + count, 0);
+            std::rotate(layerHashes.begin(), layerHashes.end() - count, layerHashes.end());
+            std::fill(layerHashes.begin(), layerHashes.begin() + count, 0);
+            rehashLayers();
+
+            for (int y = 0; y < count; ++y) {
+                for (int z = 0; z < depth; ++z) {
+                    for (int x = 0; x < width; ++x) {
+                        if (x != holeX || z != holeZ) {
+                            occupyCell(x, y, z, colorIndex);
+                        }
+                    }
+                }
+            }
+            return kept;
         }
 
-        // Clears any fully occupied lines (layers) and shifts the above layers down
-        int clearLines() {
+        // Clears any fully occupied lines (layers) and shifts the above layers down.
+        // The indices the cleared layers had before the call are written to clearedLayers if given.
+        int clearLines(std::array<int, 4>* clearedLayers = nullptr) {
             int lines = 0;
             int y = 0;
             while(y < height){
                 // Check if the layer is fully occupied
                 if (lineCounters[y] == width * depth) {
-                    // Clear the layer
-                    for (int z = 0; z < depth; ++z) {
-                        for (int x = 0; x < width; ++x) {
-                            cells[x][y][z] = false;
-                        }
+                    // Shift the layers above this one down, overwriting it: colours, masks and counters move together
+                    if (sparse) {
+                        sparseBoard.removeLayer(y);
+                    } else {
+                        kernels->removeLayer(getBoardView(), cellColors.data(), rowMasks.data(), y);
                     }
-
-                    // Shift the layers above this one down
                     for (int ny = y; ny < height - 1; ++ny) {
-                        for (int z = 0; z < depth; ++z) {
-                            for (int x = 0; x < width; ++x) {
-                                cells[x][ny][z] = cells[x][ny + 1][z];
-                            }
-                        }
-                        // Update the line counter for the shifted layer
+                        // Update the line counter and hash for the shifted layer
                         lineCounters[ny] = lineCounters[ny + 1];
+                        layerHashes[ny] = layerHashes[ny + 1];
                     }
 
                     // Clear the topmost layer
                     lineCounters[height - 1] = 0;
+                    layerHashes[height - 1] = 0;
+                    if (clearedLayers && lines < 4) {
+                        (*clearedLayers)[lines] = y + lines;
+                    }
                     lines+=1;
                     y--;
                 }
                 y++;
             }
+            if (lines > 0) {
+                rehashLayers();
+            }
             return lines;
         }
 
-        void draw(const Shader& shader) const {
-            shader.setUniform1i("isGRID", true);
-            glm::mat4 identityModel = glm::mat4(1.0f);
-            shader.setUniformMatrix4fv("model", identityModel);
-            glBindVertexArray(VAO);
-            glDrawArrays(GL_LINES, 0, vertexCount);
-            glBindVertexArray(0);
+        bool isCellOccupied(int x, int y, int z) const {
+            return sparse ? sparseBoard.isOccupied(x, y, z) : cellColors[cellIndex(x, y, z)] != palette::EMPTY;
         }
 
-        bool isCellOccupied(int x, int y, int z) const {
-            return cells[x][y][z];
+        // Batch form of checkCollision over every horizontal translation of a piece, for bots and hints.
+        // The piece is placed with its lowest blocks on layer y and its min x/z corner on (ox, oz):
+        // bit ox % 64 of fitMasks[oz * getFitWords() + ox / 64] is set when it fits there, that is
+        // bit ox of fitMasks[oz] up to MAX_WIDTH columns. fitMasks must hold getDepth() * getFitWords()
+        // entries. Grids wider than MAX_WIDTH are tested cell by cell.
+        void queryFits(const Tetromino& tetromino, int y, uint64_t* fitMasks) const {
+            PieceFootprint fp(tetromino);
+            if (width > MAX_WIDTH) {
+                scalarFits(fp, y, fitMasks);
+                return;
+            }
+            fitsAtLayer(fp, y, fitMasks);
+        }
+
+        // Words per z row of a queryFits result, 1 up to MAX_WIDTH columns
+        int getFitWords() const {
+            return (width + 63) / 64;
+        }
+
+        // Layer the lowest blocks of the piece come to rest on when dropped from startY, for every
+        // translation (same placement as queryFits), or -1 where it does not fit at startY.
+        // landingLayers must hold getWidth() * getDepth() entries, indexed oz * width + ox.
+        // Grids wider than MAX_WIDTH are tested cell by cell instead.
+        void queryLandingLayers(const Tetromino& tetromino, int startY, int* landingLayers) const {
+            PieceFootprint fp(tetromino);
+            std::fill(landingLayers, landingLayers + width * depth, -1);
+            if (width > MAX_WIDTH) {
+                scalarLandingLayers(fp, startY, landingLayers);
+                return;
+            }
+
+            ScratchRows falling(depth), fits(depth);
+            fitsAtLayer(fp, startY, falling.data());
+            for (int y = startY - 1; y >= -1; --y) {
+                fitsAtLayer(fp, y, fits.data()); // Nothing fits at -1, so everything lands on the floor
+                bool anyFalling = false;
+                for (int oz = 0; oz < depth; ++oz) {
+                    uint64_t landed = falling[oz] & ~fits[oz];
+                    while (landed) {
+                        landingLayers[oz * width + __builtin_ctzll(landed)] = y + 1;
+                        landed &= landed - 1;
+                    }
+                    falling[oz] &= fits[oz];
+                    anyFalling = anyFalling || falling[oz];
+                }
+                if (!anyFalling) break;
+            }
         }
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,206 @@
+#ifndef GRIDKERNELS_H
+#define GRIDKERNELS_H
+
+#include "Tetromino.h"
+#include "Palette.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Board sizes with a dedicated layer removal, X(width, height, depth). Any other size uses the generic one.
+#define TETRIS_BOARD_SIZES(X) \
+    X(4, 16, 4)               \
+    X(6, 20, 6)               \
+    X(8, 24, 8)               \
+    X(10, 40, 10)
+
+// What the kernels read of a Grid
+struct BoardView {
+    int width, height, depth;
+    const uint8_t* colors;    // Palette indices, layer-major: (y * depth + z) * width + x
+    const uint64_t* rowMasks; // One bit per x for every (y, z) row, indexed y * depth + z
+};
+
+// Blocks of a piece relative to its lowest, min x/z corner
+struct PieceFootprint {
+    int count = 0;
+    std::array<int, 4> x, y, z;
+    int sizeX = 0, sizeY = 0, sizeZ = 0;
+
+    PieceFootprint() {}
+
+    explicit PieceFootprint(const Tetromino& tetromino) {
+        const std::vector<Block>& blocks = tetromino.getBlocks();
+        count = static_cast<int>(std::min<size_t>(blocks.size(), 4));
+        if (count == 0) return;
+
+        glm::vec3 minPos = blocks[0].getPosition();
+        glm::vec3 maxPos = minPos;
+        for (int b = 1; b < count; ++b) {
+            glm::vec3 pos = blocks[b].getPosition();
+            minPos = glm::vec3(std::min(minPos.x, pos.x), std::min(minPos.y, pos.y), std::min(minPos.z, pos.z));
+            maxPos = glm::vec3(std::max(maxPos.x, pos.x), std::max(maxPos.y, pos.y), std::max(maxPos.z, pos.z));
+        }
+        for (int b = 0; b < count; ++b) {
+            glm::vec3 pos = blocks[b].getPosition();
+            x[b] = static_cast<int>(pos.x - minPos.x);
+            y[b] = static_cast<int>(pos.y - minPos.y);
+            z[b] = static_cast<int>(pos.z - minPos.z);
+        }
+        sizeX = static_cast<int>(maxPos.x - minPos.x) + 1;
+        sizeY = static_cast<int>(maxPos.y - minPos.y) + 1;
+        sizeZ = static_cast<int>(maxPos.z - minPos.z) + 1;
+    }
+};
+
+// Hot loops of Grid that read a few cells or rows per call, for any board size. Built
+// for fixed sizes they measured slower in ./bench, see README.md.
+struct GridKernels {
+    static uint64_t lowBits(int count) {
+        return count >= 64 ? ~0ull : (1ull << count) - 1;
+    }
+
+    static bool collides(const BoardView& board, const std::vector<Block>& blocks) {
+        const int w = board.width, h = board.height, d = board.depth;
+        for (const Block& block : blocks) {
+            glm::vec3 pos = block.getPosition();
+            int x = static_cast<int>(pos.x);
+            int y = static_cast<int>(pos.y);
+            int z = static_cast<int>(pos.z);
+            if (x < 0 || x >= w || y < 0 || y >= h || z < 0 || z >= d) {
+                return true;
+            }
+            if (board.colors[(static_cast<size_t>(y) * d + z) * w + x] != palette::EMPTY) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Cells the blocks can move straight down before one rests on the floor or on an
+    // occupied cell; 0 when a block is already outside the board
+    static int dropDistance(const BoardView& board, const std::vector<Block>& blocks) {
+        const int w = board.width, h = board.height, d = board.depth;
+        int distance = h;
+        for (const Block& block : blocks) {
+            glm::vec3 pos = block.getPosition();
+            int x = static_cast<int>(pos.x);
+            int y = static_cast<int>(pos.y);
+            int z = static_cast<int>(pos.z);
+            if (x < 0 || x >= w || y < 0 || y >= h || z < 0 || z >= d) {
+                return 0;
+            }
+            // Only the cells within the best distance so far matter
+            int free = 0;
+            for (int ny = y - 1; ny >= 0 && free < distance; --ny, ++free) {
+                if (board.colors[(static_cast<size_t>(ny) * d + z) * w + x] != palette::EMPTY) break;
+            }
+            distance = std::min(distance, free);
+        }
+        return distance;
+    }
+
+    // fitMasks[oz] gets a bit per ox where the footprint fits with its lowest blocks on layer y.
+    // A translation collides when any block lands on an occupied cell, so the rows under each
+    // block are shifted by the block offset and OR-ed together, for several z rows at once.
+    static void fitsAtLayer(const BoardView& board, const PieceFootprint& fp, int y, uint64_t* fitMasks) {
+        const int w = board.width, h = board.height, d = board.depth;
+        int zCount = d - fp.sizeZ + 1;
+        if (fp.count == 0 || y < 0 || y + fp.sizeY > h || zCount <= 0 || fp.sizeX > w) {
+            std::fill(fitMasks, fitMasks + d, 0);
+            return;
+        }
+        uint64_t validX = lowBits(w - fp.sizeX + 1);
+        const uint64_t* layerRows[4];
+        for (int b = 0; b < fp.count; ++b) {
+            layerRows[b] = board.rowMasks + (y + fp.y[b]) * d + fp.z[b];
+        }
+
+        int oz = 0;
+#if defined(__AVX2__)
+        __m256i validX4 = _mm256_set1_epi64x(static_cast<long long>(validX));
+        for (; oz + 4 <= zCount; oz += 4) {
+            __m256i blocked = _mm256_setzero_si256();
+            for (int b = 0; b < fp.count; ++b) {
+                __m256i rows = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(layerRows[b] + oz));
+                blocked = _mm256_or_si256(blocked, _mm256_srl_epi64(rows, _mm_cvtsi32_si128(fp.x[b])));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(fitMasks + oz), _mm256_andnot_si256(blocked, validX4));
+        }
+#endif
+#if defined(__SSE2__)
+        __m128i validX2 = _mm_set1_epi64x(static_cast<long long>(validX));
+        for (; oz + 2 <= zCount; oz += 2) {
+            __m128i blocked = _mm_setzero_si128();
+            for (int b = 0; b < fp.count; ++b) {
+                __m128i rows = _mm_loadu_si128(reinterpret_cast<const __m128i*>(layerRows[b] + oz));
+                blocked = _mm_or_si128(blocked, _mm_srl_epi64(rows, _mm_cvtsi32_si128(fp.x[b])));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(fitMasks + oz), _mm_andnot_si128(blocked, validX2));
+        }
+#endif
+        for (; oz < zCount; ++oz) {
+            uint64_t blocked = 0;
+            for (int b = 0; b < fp.count; ++b) {
+                blocked |= layerRows[b][oz] >> fp.x[b];
+            }
+            fitMasks[oz] = ~blocked & validX;
+        }
+        std::fill(fitMasks + zCount, fitMasks + d, 0);
+    }
+};
+
+// Layer removal, the one loop a constant board size speeds up: with the size as template
+// arguments every stride and copy length is a constant and the layer copies become
+// fixed-size moves. LayerKernels<0, 0, 0> is the generic version, reading the size from
+// the BoardView.
+template <int W, int H, int D>
+struct LayerKernels {
+    static int width(const BoardView& board) { return W ? W : board.width; }
+    static int height(const BoardView& board) { return H ? H : board.height; }
+    static int depth(const BoardView& board) { return D ? D : board.depth; }
+
+    // Moves every layer above y one layer down, overwriting y, and empties the top layer
+    static void removeLayer(const BoardView& board, uint8_t* colors, uint64_t* rowMasks, int y) {
+        const int w = width(board), h = height(board), d = depth(board);
+        const size_t layerSize = static_cast<size_t>(w) * d;
+        for (int ny = y; ny < h - 1; ++ny) {
+            std::memcpy(colors + ny * layerSize, colors + (ny + 1) * layerSize, layerSize);
+            std::memcpy(rowMasks + ny * d, rowMasks + (ny + 1) * d, d * sizeof(uint64_t));
+        }
+        std::memset(colors + (h - 1) * layerSize, palette::EMPTY, layerSize);
+        std::memset(rowMasks + (h - 1) * d, 0, d * sizeof(uint64_t));
+    }
+};
+
+struct GridKernelTable {
+    void (*removeLayer)(const BoardView&, uint8_t*, uint64_t*, int);
+    const char* name;
+};
+
+template <int W, int H, int D>
+const GridKernelTable& gridKernelTable() {
+    static const GridKernelTable table = {
+        &LayerKernels<W, H, D>::removeLayer,
+        W ? "sized" : "generic"
+    };
+    return table;
+}
+
+// Picks the kernels built for this exact size, or the generic ones
+inline const GridKernelTable& selectGridKernels(int width, int height, int depth) {
+#define TETRIS_SELECT_KERNELS(w, h, d) \
+    if (width == w && height == h && depth == d) return gridKernelTable<w, h, d>();
+    TETRIS_BOARD_SIZES(TETRIS_SELECT_KERNELS)
+#undef TETRIS_SELECT_KERNELS
+    return gridKernelTable<0, 0, 0>();
+}
+
+#endif
@@ -5,17 +5,12 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "GameState.h"
-#include "TextShader.h"
-#include <vector>
+#include "UIRenderer.h"
 
 class HowToPlayScreen {
 public:
-    HowToPlayScreen(GLFWwindow* window, GameState& state)
-        : window(window), state(state), textShader() {
-        projection = glm::ortho(0.0f, 1600.0f, 0.0f, 1200.0f);
-        textShader.use();
-        textShader.setMat4("projection", projection);
-    }
+    HowToPlayScreen(GLFWwindow* window, GameState& state, UIRenderer& ui)
+        : window(window), state(state), ui(ui) {}
 
     void display() {
         int windowWidth, windowHeight;
@@ -28,8 +23,17 @@ public:
         // Check hover state for the "RETURN TO MENU" button
         bool returnHovered = isMouseOverButton(mouseX, mouseY, windowWidth / 2 - 100.0f, 50.0f, 200.0f, 50.0f);
 
-        // Draw instructions
-        drawInstructions(windowWidth, windowHeight, returnHovered);
+        // Rebuild the instructions only when the hover state or the window changed
+        if (returnHovered != builtHovered || windowWidth != builtWidth || windowHeight != builtHeight) {
+            batch.clear();
+            drawInstructions(windowWidth, windowHeight, returnHovered);
+            batch.upload();
+
+            builtHovered = returnHovered;
+            builtWidth = windowWidth;
+            builtHeight = windowHeight;
+        }
+        ui.draw(batch);
 
         // Handle click on "RETURN TO MENU"
         if (returnHovered && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
@@ -40,29 +44,41 @@ public:
 private:
     GLFWwindow* window;
     GameState& state;
-    TextShader textShader;
-    glm::mat4 projection;
+    UIRenderer& ui;
+    UIBatch batch;
+    int builtHovered = -1;
+    int builtWidth = 0, builtHeight = 0;
+
+    struct InstructionGroup {
+        const char* title;
+        const char* const* lines;
+        int lineCount;
+    };
+
+    static constexpr const char* MOVEMENT_INSTRUCTIONS[] = {
+        "Key S: Move down",
+        "Key A: Move left X-axis",
+        "Key D: Move right X-axis",
+        "Key Q: Move left Z-axis",
+        "Key E: Rotate right Z-axis",
+        "Key  SPACE: Move to projected position",
+    };
+
+    static constexpr const char* ROTATION_INSTRUCTIONS[] = {
+        "Key Z: Rotate around Z-axis",
+        "Key X: Rotate around X-axis",
+        "Key C: Rotate around Y-axis"
+    };
 
     void drawInstructions(float windowWidth, float windowHeight, bool returnHovered) {
         float introX = windowWidth / 2 - 200.0f;
         float introY = windowHeight - 100.0f;
-        textShader.renderText("Welcome to Tetris 3D!", introX, introY, 0.9f, glm::vec3(1.0f, 1.0f, 1.0f));
-        textShader.renderText("Use the following keys to play the game:", introX, introY - 30.0f, 0.7f, glm::vec3(1.0f, 1.0f, 1.0f));
-
-        std::vector<std::pair<std::string, std::vector<std::string>>> groupedInstructions = {
-            {"Movement Controls:", {
-                "Key S: Move down",
-                "Key A: Move left X-axis",
-                "Key D: Move right X-axis",
-                "Key Q: Move left Z-axis",
-                "Key E: Rotate right Z-axis",
-                "Key  SPACE: Move to projected position",
-            }},
-            {"Rotation Controls:", {
-                "Key Z: Rotate around Z-axis",
-                "Key X: Rotate around X-axis",
-                "Key C: Rotate around Y-axis"
-            }}
+        ui.addText(batch, "Welcome to Tetris 3D!", introX, introY, 0.9f, glm::vec3(1.0f, 1.0f, 1.0f));
+        ui.addText(batch, "Use the following keys to play the game:", introX, introY - 30.0f, 0.7f, glm::vec3(1.0f, 1.0f, 1.0f));
+
+        const InstructionGroup groupedInstructions[] = {
+            {"Movement Controls:", MOVEMENT_INSTRUCTIONS, 6},
+            {"Rotation Controls:", ROTATION_INSTRUCTIONS, 3}
         };
 
         float x = windowWidth / 2 - 200.0f;
@@ -71,11 +87,11 @@ private:
         float lineSpacing = 30.0f;
 
         for (const auto& group : groupedInstructions) {
-            textShader.renderText(group.first, x, y, 0.7f, glm::vec3(1.0f, 1.0f, 0.0f));
+            ui.addText(batch, group.title, x, y, 0.7f, glm::vec3(1.0f, 1.0f, 0.0f));
             y -= groupSpacing;
 
-            for (const auto& instruction : group.second) {
-                textShader.renderText(instruction, x + 20.0f, y, 0.6f, glm::vec3(1.0f, 1.0f, 1.0f));
+            for (int i = 0; i < group.lineCount; ++i) {
+                ui.addText(batch, group.lines[i], x + 20.0f, y, 0.6f, glm::vec3(1.0f, 1.0f, 1.0f));
                 y -= lineSpacing;
             }
 
@@ -85,7 +101,7 @@ private:
         float buttonX = windowWidth / 2 - 100.0f;
         float buttonY = 50.0f;
         glm::vec3 buttonColor = returnHovered ? glm::vec3(1.0f, 0.8f, 0.0f) : glm::vec3(1.0f, 1.0f, 0.0f);
-        textShader.renderText("RETURN TO MENU", buttonX, buttonY, 0.8f, buttonColor);
+        ui.addText(batch, "RETURN TO MENU", buttonX, buttonY, 0.8f, buttonColor);
     }
 
     bool isMouseOverButton(double mouseX, double mouseY, float buttonX, float buttonY, float buttonWidth, float buttonHeight) {
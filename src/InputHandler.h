@@ -2,46 +2,100 @@
 #define INPUTHANDLER_H
 
 #include "Game.h"
+#include "InputQueue.h"
+#include "LatencyTracker.h"
+#include <GLFW/glfw3.h>
+#include <array>
+
 class InputHandler {
+private:
+    // Ticks a movement key has to be held before it starts repeating (delayed auto-shift)
+    const int DAS_TICKS = 10;
+    // Ticks between two repeats once auto-repeat is active
+    const int ARR_TICKS = 3;
+
+    // Keys that auto-repeat while held; rotations and the hard drop only fire on press
+    const std::array<int, 5> REPEATABLE_KEYS = { GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_Q, GLFW_KEY_E };
+
+    // Number of ticks each key has been held, 0 when released
+    std::array<int, GLFW_KEY_LAST + 1> heldTicks{};
+
+    // Receives the timestamp of every press that changed the game, may be null
+    LatencyTracker* latencyTracker = nullptr;
+
 public:
-    // Processes user input and performs the corresponding actions on the game
-    void handleInput(int key, Game& game) {
+    void setLatencyTracker(LatencyTracker* tracker) {
+        latencyTracker = tracker;
+    }
+
+    // Drains the queue and applies the resulting actions, called once per simulation tick.
+    // OS key repeats are ignored: auto-repeat is driven by the tick counter instead, so
+    // the cost per tick is bounded and independent of the keyboard settings.
+    void processInput(InputQueue& queue, Game& game) {
+        InputEvent event;
+        while (queue.pop(event)) {
+            if (event.key < 0 || event.key > GLFW_KEY_LAST) {
+                continue;
+            }
+            if (event.action == GLFW_PRESS) {
+                if (heldTicks[event.key] == 0) {
+                    if (handleInput(event.key, game) && latencyTracker) {
+                        latencyTracker->onStateChanged(event.time);
+                    }
+                    heldTicks[event.key] = 1;
+                }
+            } else if (event.action == GLFW_RELEASE) {
+                heldTicks[event.key] = 0;
+            }
+        }
+
+        for (int key : REPEATABLE_KEYS) {
+            if (heldTicks[key] == 0) {
+                continue;
+            }
+            int repeatTicks = heldTicks[key] - DAS_TICKS;
+            if (repeatTicks > 0 && repeatTicks % ARR_TICKS == 0) {
+                handleInput(key, game);
+            }
+            heldTicks[key]++;
+        }
+    }
+
+    // Forgets every held key, e.g. when leaving the game screen
+    void reset() {
+        heldTicks.fill(0);
+    }
+
+    // Processes user input and performs the corresponding actions on the game.
+    // Returns true if the game state changed.
+    bool handleInput(int key, Game& game) {
     switch (key) {
     case GLFW_KEY_S: // Move the current Tetromino down
-        game.moveTetromino(glm::vec3(0, -1, 0));
-        break;
+        return game.moveTetromino(glm::vec3(0, -1, 0));
 
     case GLFW_KEY_A: // Move the current Tetromino left
-        game.moveTetromino(glm::vec3(-1, 0, 0));
-        break;
+        return game.moveTetromino(glm::vec3(-1, 0, 0));
 
     case GLFW_KEY_D: // Move the current Tetromino right
-        game.moveTetromino(glm::vec3(1, 0, 0));
-        break;
+        return game.moveTetromino(glm::vec3(1, 0, 0));
     
     case GLFW_KEY_Q: // Move the current Tetromino up
-        game.moveTetromino(glm::vec3(0, 0, -1));
-        break;
+        return game.moveTetromino(glm::vec3(0, 0, -1));
 
     case GLFW_KEY_E: // Rotate the Tetromino 90 degrees around the X-axis
-        game.moveTetromino(glm::vec3(0, 0, 1));
-        break;
+        return game.moveTetromino(glm::vec3(0, 0, 1));
 
     case GLFW_KEY_Z: // Rotate the Tetromino 90 degrees around the Z-axis
-        game.rotateTetromino(90.0f, glm::vec3(0, 0, 1));
-        break;
+        return game.rotateTetromino(90.0f, glm::vec3(0, 0, 1));
     case GLFW_KEY_X: // Rotate the Tetromino 90 degrees around the X-axis
-        game.rotateTetromino(90.0f, glm::vec3(1, 0, 0));
-        break;
+        return game.rotateTetromino(90.0f, glm::vec3(1, 0, 0));
     case GLFW_KEY_C: // Rotate the Tetromino 90 degrees around the Y-axis
-        game.rotateTetromino(90.0f, glm::vec3(0, 1, 0));
-        break;
+        return game.rotateTetromino(90.0f, glm::vec3(0, 1, 0));
     case GLFW_KEY_SPACE: // Restart the game
-        game.moveTetrominoToProjectedPosition();
-        break;
+        return game.moveTetrominoToProjectedPosition();
     default:
         // Optional: Handle invalid keys or no-op
-        break;
+        return false;
     }
 }
 
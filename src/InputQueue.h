@@ -0,0 +1,57 @@
+#ifndef INPUTQUEUE_H
+#define INPUTQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// A key event as reported by GLFW, stamped with the time it reached the callback
+struct InputEvent {
+    int key;
+    int action;  // GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT
+    double time; // glfwGetTime() when the callback fired
+};
+
+// Lock-free single-producer / single-consumer ring buffer of input events.
+// The GLFW key callback pushes, the simulation drains once per tick.
+class InputQueue {
+    private:
+        static const size_t CAPACITY = 256; // Must be a power of two
+
+        std::array<InputEvent, CAPACITY> events;
+        std::atomic<size_t> head{0}; // Next slot to read, owned by the consumer
+        std::atomic<size_t> tail{0}; // Next slot to write, owned by the producer
+
+    public:
+        // Returns false (and drops the event) if the consumer has fallen too far behind
+        bool push(const InputEvent& event) {
+            size_t currentTail = tail.load(std::memory_order_relaxed);
+            if (currentTail - head.load(std::memory_order_acquire) == CAPACITY) {
+                return false;
+            }
+            events[currentTail & (CAPACITY - 1)] = event;
+            tail.store(currentTail + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(InputEvent& event) {
+            size_t currentHead = head.load(std::memory_order_relaxed);
+            if (currentHead == tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            event = events[currentHead & (CAPACITY - 1)];
+            head.store(currentHead + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Discards everything queued so far (consumer side)
+        void clear() {
+            head.store(tail.load(std::memory_order_acquire), std::memory_order_release);
+        }
+
+        bool isEmpty() const {
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+};
+
+#endif
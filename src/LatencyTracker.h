@@ -0,0 +1,178 @@
+#ifndef LATENCYTRACKER_H
+#define LATENCYTRACKER_H
+
+#include <GL/glew.h>
+#include "FrameArena.h"
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+// Fixed-size latency histogram with 0.1 ms buckets, the last bucket collects everything above 100 ms
+class LatencyHistogram {
+    private:
+        static const int BUCKETS = 1000;
+        const double BUCKET_WIDTH = 0.0001; // seconds
+
+        std::array<uint32_t, BUCKETS> counts{};
+        uint64_t total = 0;
+
+    public:
+        void add(double seconds) {
+            int bucket = static_cast<int>(seconds / BUCKET_WIDTH);
+            if (bucket < 0) bucket = 0;
+            if (bucket >= BUCKETS) bucket = BUCKETS - 1;
+            counts[bucket]++;
+            total++;
+        }
+
+        // Upper bound of the bucket holding the given percentile (0..1), in seconds
+        double percentile(double p) const {
+            if (total == 0) return 0.0;
+            uint64_t rank = static_cast<uint64_t>(p * (total - 1)) + 1;
+            uint64_t seen = 0;
+            for (int i = 0; i < BUCKETS; ++i) {
+                seen += counts[i];
+                if (seen >= rank) {
+                    return (i + 1) * BUCKET_WIDTH;
+                }
+            }
+            return BUCKETS * BUCKET_WIDTH;
+        }
+
+        uint64_t getCount() const {
+            return total;
+        }
+
+        void reset() {
+            counts.fill(0);
+            total = 0;
+        }
+};
+
+// Measures the time from a key event reaching the GLFW callback to the first
+// glfwSwapBuffers presenting the game state it changed. Optionally also measures
+// until the GPU has finished that frame, using a fence inserted after the swap.
+// The fence is only seen signaled when polled, after the swap and at the start of the
+// next frame, so the GPU time is an upper bound, late by up to the pacing wait.
+class LatencyTracker {
+    private:
+        static const int MAX_PENDING = 32;
+        static const int MAX_FENCES = 8;
+        const double REPORT_INTERVAL = 10.0; // seconds
+
+        struct PendingFence {
+            GLsync fence = nullptr;
+            std::array<double, MAX_PENDING> stamps;
+            int stampCount = 0;
+        };
+
+        // Input stamps whose state change has not been presented yet
+        std::array<double, MAX_PENDING> pendingStamps;
+        int pendingCount = 0;
+
+        std::array<PendingFence, MAX_FENCES> fences;
+
+        LatencyHistogram presentHistogram;
+        LatencyHistogram gpuHistogram;
+        bool gpuTiming;
+        double lastReport = 0.0;
+
+        void printLine(const char* label, const LatencyHistogram& histogram) const {
+            std::cerr << "[Latency] " << label
+                      << " p50=" << histogram.percentile(0.50) * 1000.0 << "ms"
+                      << " p95=" << histogram.percentile(0.95) * 1000.0 << "ms"
+                      << " p99=" << histogram.percentile(0.99) * 1000.0 << "ms"
+                      << " (n=" << histogram.getCount() << ")" << std::endl;
+        }
+
+    public:
+        LatencyTracker(bool gpuTiming = false): gpuTiming(gpuTiming) {}
+
+        // Called when an input event actually changed the game state
+        void onStateChanged(double inputTime) {
+            if (pendingCount < MAX_PENDING) {
+                pendingStamps[pendingCount++] = inputTime;
+            }
+        }
+
+        // Called right after glfwSwapBuffers
+        void onFramePresented(double now) {
+            if (pendingCount == 0) return;
+
+            for (int i = 0; i < pendingCount; ++i) {
+                presentHistogram.add(now - pendingStamps[i]);
+            }
+
+            if (gpuTiming) {
+                for (PendingFence& pending : fences) {
+                    if (pending.fence == nullptr) {
+                        pending.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                        pending.stamps = pendingStamps;
+                        pending.stampCount = pendingCount;
+                        break;
+                    }
+                }
+                // When every fence slot is busy the sample is only counted in the present histogram
+            }
+            pendingCount = 0;
+        }
+
+        // Polls outstanding fences without blocking. A fence is stamped with the time of the
+        // first poll that sees it signaled.
+        void pollGpuFences(double now) {
+            for (PendingFence& pending : fences) {
+                if (pending.fence == nullptr) continue;
+
+                GLenum status = glClientWaitSync(pending.fence, 0, 0);
+                if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+                    for (int i = 0; i < pending.stampCount; ++i) {
+                        gpuHistogram.add(now - pending.stamps[i]);
+                    }
+                    glDeleteSync(pending.fence);
+                    pending.fence = nullptr;
+                }
+            }
+        }
+
+        // Logs the percentiles every REPORT_INTERVAL seconds
+        void report(double now) {
+            if (now - lastReport < REPORT_INTERVAL) return;
+            lastReport = now;
+
+            if (presentHistogram.getCount() > 0) {
+                printLine("input-to-present", presentHistogram);
+            }
+            if (gpuHistogram.getCount() > 0) {
+                printLine("input-to-gpu-done (upper bound)", gpuHistogram);
+            }
+        }
+
+        // Single line summary for the debug overlay, valid until the arena is reset
+        const char* overlayText(FrameArena& arena) const {
+            return arena.format("Latency p50 %.1f p95 %.1f p99 %.1f ms",
+                                presentHistogram.percentile(0.50) * 1000.0,
+                                presentHistogram.percentile(0.95) * 1000.0,
+                                presentHistogram.percentile(0.99) * 1000.0);
+        }
+
+        const LatencyHistogram& getPresentHistogram() const {
+            return presentHistogram;
+        }
+
+        const LatencyHistogram& getGpuHistogram() const {
+            return gpuHistogram;
+        }
+
+        void cleanUp() {
+            for (PendingFence& pending : fences) {
+                if (pending.fence != nullptr) {
+                    glDeleteSync(pending.fence);
+                    pending.fence = nullptr;
+                }
+            }
+        }
+};
+
+#endif
@@ -5,20 +5,16 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "GameState.h"
-#include "TextShader.h"
-#include <vector>
+#include "UIRenderer.h"
+#include <array>
+#include <cmath>
 
 class Menu {
 public:
-    Menu(GLFWwindow* window, GameState& state)
-        : window(window), state(state), textShader() {
-        projection = glm::ortho(0.0f, 1600.0f, 0.0f, 1200.0f);
-    }
+    Menu(GLFWwindow* window, GameState& state, UIRenderer& ui)
+        : window(window), state(state), ui(ui) {}
 
     void displayMenu() {
-        textShader.use();
-        textShader.setMat4("projection", projection);
-
         int windowWidth, windowHeight;
         glfwGetWindowSize(window, &windowWidth, &windowHeight);
 
@@ -39,12 +35,28 @@ public:
         bool howToPlayHovered = isMouseOverButton(mouseX, mouseY, howToPlayX, howToPlayY, buttonWidth, buttonHeight);
         bool quitHovered = isMouseOverButton(mouseX, mouseY, quitX, quitY, buttonWidth, buttonHeight);
 
-        // Draw elements
-        drawTitle(windowWidth, windowHeight);
-        drawButton(startX, startY, buttonWidth, buttonHeight, "START", glm::vec3(1.0f, 1.0f, 1.0f), startHovered);
-        drawButton(howToPlayX, howToPlayY, buttonWidth, buttonHeight, "HOW TO PLAY", glm::vec3(1.0f, 1.0f, 1.0f), howToPlayHovered);
-        drawButton(quitX, quitY, buttonWidth, buttonHeight, "QUIT", glm::vec3(1.0f, 1.0f, 1.0f), quitHovered);
-        drawFooter(windowWidth);
+        // Rebuild the geometry only when something visible changed
+        int hoverState = (startHovered ? 1 : 0) | (howToPlayHovered ? 2 : 0) | (quitHovered ? 4 : 0);
+        if (hoverState != builtHoverState || windowWidth != builtWidth || windowHeight != builtHeight) {
+            batch.clear();
+            drawTitle(windowWidth, windowHeight);
+            drawButton(startX, startY, buttonWidth, buttonHeight, "START", glm::vec3(1.0f, 1.0f, 1.0f), startHovered);
+            drawButton(howToPlayX, howToPlayY, buttonWidth, buttonHeight, "HOW TO PLAY", glm::vec3(1.0f, 1.0f, 1.0f), howToPlayHovered);
+            drawButton(quitX, quitY, buttonWidth, buttonHeight, "QUIT", glm::vec3(1.0f, 1.0f, 1.0f), quitHovered);
+            drawFooter(windowWidth);
+            drawFallingLetter(windowWidth, windowHeight);
+            batch.upload();
+
+            builtHoverState = hoverState;
+            builtWidth = windowWidth;
+            builtHeight = windowHeight;
+        }
+
+        // The static layout and the falling letter of the title, which only moves through a uniform
+        ui.draw(batch, 0, fallingLetterFirst);
+        // Time based so the animation speed does not depend on how often the menu is redrawn
+        float fallingOffset = static_cast<float>(std::fmod(glfwGetTime() * FALLING_SPEED, 100.5));
+        ui.draw(batch, fallingLetterFirst, batch.vertexCount() - fallingLetterFirst, glm::vec2(0.0f, -fallingOffset));
 
         // Handle click events
         if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
@@ -55,7 +67,6 @@ public:
                 state = HowToPlay;
             }
             if (quitHovered) {
-                textShader.cleanup();
                 glfwSetWindowShouldClose(window, true);
             }
         }
@@ -64,60 +75,69 @@ public:
 private:
     GLFWwindow* window;
     GameState& state;
-    TextShader textShader;
-    glm::mat4 projection;
-    float fallingOffset = 0.0f;
+    UIRenderer& ui;
+    UIBatch batch;
+    int builtHoverState = -1;
+    int builtWidth = 0, builtHeight = 0;
+    int fallingLetterFirst = 0; // First vertex of the animated letter in the batch
+    const double FALLING_SPEED = 30.0; // Pixels per second
     const float buttonWidth = 200.0f, buttonHeight = 50.0f;
+    const float BUTTON_PADDING = 10.0f; // Between the label and the sides of its button
+    const float titleSize = 3.5f;
+
+    const std::array<glm::vec3, 6> titleColors = {
+        glm::vec3(1.0f, 0.0f, 0.0f),
+        glm::vec3(1.0f, 0.5f, 0.0f),
+        glm::vec3(1.0f, 1.0f, 0.0f),
+        glm::vec3(0.0f, 1.0f, 0.0f),
+        glm::vec3(0.0f, 1.0f, 1.0f),
+        glm::vec3(1.0f, 0.0f, 1.0f)
+    };
 
     void drawTitle(float windowWidth, float windowHeight) {
-        float size = 3.5f;
         float titleX = (windowWidth / 2) - 350.0f;
         float titleY = windowHeight - 120.0f;
-        std::vector<glm::vec3> colors = {
-            glm::vec3(1.0f, 0.0f, 0.0f),
-            glm::vec3(1.0f, 0.5f, 0.0f),
-            glm::vec3(1.0f, 1.0f, 0.0f),
-            glm::vec3(0.0f, 1.0f, 0.0f),
-            glm::vec3(0.0f, 1.0f, 1.0f),
-            glm::vec3(1.0f, 0.0f, 1.0f)
-        };
-
-        std::string title = "TETRIS";
-        for (size_t i = 0; i < title.size(); ++i) {
-            float letterX = titleX + i * 120.0f;
-            float letterY = (title[i] == 'S') ? titleY - fallingOffset : titleY;
-            textShader.renderText(std::string(1, title[i]), letterX, letterY, size, colors[i]);
 
-            if (title[i] == 'S') {
-                fallingOffset = (fallingOffset > 100.0f) ? 0.0f : fallingOffset + 0.5f;
-            }
+        // Every letter but the final 'S', which is added last by drawFallingLetter
+        const char title[] = "TETRI";
+        for (size_t i = 0; title[i]; ++i) {
+            float letterX = titleX + i * 120.0f;
+            const char letter[2] = { title[i], '\0' };
+            ui.addText(batch, letter, letterX, titleY, titleSize, titleColors[i]);
         }
-        textShader.renderText("3D", titleX + 270.0f, titleY - 190.0f, size, glm::vec3(1.0f, 1.0f, 1.0f));
+        ui.addText(batch, "3D", titleX + 270.0f, titleY - 190.0f, titleSize, glm::vec3(1.0f, 1.0f, 1.0f));
+    }
+
+    void drawFallingLetter(float windowWidth, float windowHeight) {
+        float titleX = (windowWidth / 2) - 350.0f;
+        float titleY = windowHeight - 120.0f;
+        fallingLetterFirst = batch.vertexCount();
+        ui.addText(batch, "S", titleX + 5 * 120.0f, titleY, titleSize, titleColors[5]);
     }
 
     void drawFooter(float windowWidth) {
         float footerX = (windowWidth / 2) - 180.0f;
         float footerY = 20.0f;
-        textShader.renderText("Copyright: Nicolas LOPEZ and Nicolas RINCON", footerX, footerY, 0.4f, glm::vec3(1.0f, 1.0f, 1.0f));
+        ui.addText(batch, "Copyright: Nicolas LOPEZ and Nicolas RINCON", footerX, footerY, 0.4f, glm::vec3(1.0f, 1.0f, 1.0f));
     }
 
     bool isMouseOverButton(double mouseX, double mouseY, float buttonX, float buttonY, float buttonWidth, float buttonHeight) {
         return mouseX >= buttonX && mouseX <= buttonX + buttonWidth && mouseY >= buttonY && mouseY <= buttonY + buttonHeight;
     }
 
-    void drawButton(float x, float y, float width, float height, const std::string& text, glm::vec3 textColor, bool isHovered) {
-        glBegin(GL_QUADS);
-        glColor3f(0.2f, 0.2f, 0.2f);
-        glVertex2f(x, y);
-        glVertex2f(x + width, y);
-        glVertex2f(x + width, y + height);
-        glVertex2f(x, y + height);
-        glEnd();
+    void drawButton(float x, float y, float width, float height, const char* text, glm::vec3 textColor, bool isHovered) {
+        ui.addQuad(batch, x, y, width, height, glm::vec3(0.2f, 0.2f, 0.2f));
 
         glm::vec3 finalTextColor = isHovered ? glm::vec3(1.0f, 0.8f, 0.0f) : textColor;
-        float textX = x + (width / 2) - (text.size() * 10.0f) / 2;
-        float textY = y + height+(height/2);
-        textShader.renderText(text, textX, textY, 1.0f, finalTextColor);
+        // Centred in the quad, shrunk when the label would be wider than it
+        float scale = 1.0f;
+        float fullWidth = ui.textWidth(text, 1.0f);
+        if (fullWidth > width - 2 * BUTTON_PADDING) {
+            scale = (width - 2 * BUTTON_PADDING) / fullWidth;
+        }
+        float textX = x + (width - ui.textWidth(text, scale)) / 2;
+        float textY = y + (height - ui.textAscent(text, scale)) / 2;
+        ui.addText(batch, text, textX, textY, scale, finalTextColor);
     }
 };
 
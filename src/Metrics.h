@@ -0,0 +1,241 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Always-on counters and histograms. Every thread writes to its own
+// cache-line aligned slot without contention; values are summed over all
+// slots when read, e.g. by the Prometheus text-file exporter.
+namespace metrics {
+
+enum class Counter {
+    PiecesSpawned,
+    CollisionChecks,
+    RotationsRejected,
+    LineClears1,
+    LineClears2,
+    LineClears3,
+    LineClears4,
+    GlyphsDrawn,
+    Count
+};
+
+enum class Histogram {
+    UpdateSeconds, // Cost of one Game::update call
+    FrameSeconds,  // Time between two frames
+    Count
+};
+
+const int COUNTER_COUNT = static_cast<int>(Counter::Count);
+const int HISTOGRAM_COUNT = static_cast<int>(Histogram::Count);
+const int MAX_THREADS = 64;
+
+// Upper bounds of the histogram buckets in seconds, a last +Inf bucket is implicit
+const std::array<double, 10> BUCKET_BOUNDS = { 0.0001, 0.0005, 0.001, 0.002, 0.004, 0.008, 0.016, 0.033, 0.066, 0.1 };
+const int BUCKET_COUNT = static_cast<int>(BUCKET_BOUNDS.size()) + 1;
+
+struct CounterInfo {
+    const char* name;
+    const char* labels;
+    const char* help;
+};
+
+const std::array<CounterInfo, COUNTER_COUNT> COUNTER_INFO = {{
+    { "tetris_pieces_spawned_total", "", "Pieces spawned." },
+    { "tetris_collision_checks_total", "", "Calls to Grid::checkCollision." },
+    { "tetris_rotations_rejected_total", "", "Rotations undone because of a collision." },
+    { "tetris_line_clears_total", "lines=\"1\"", "Line clear events by number of layers cleared." },
+    { "tetris_line_clears_total", "lines=\"2\"", "" },
+    { "tetris_line_clears_total", "lines=\"3\"", "" },
+    { "tetris_line_clears_total", "lines=\"4\"", "" },
+    { "tetris_text_glyphs_drawn_total", "", "Text glyphs drawn." }
+}};
+
+const std::array<CounterInfo, HISTOGRAM_COUNT> HISTOGRAM_INFO = {{
+    { "tetris_update_seconds", "", "Time spent in one Game::update tick." },
+    { "tetris_frame_seconds", "", "Time between two rendered frames." }
+}};
+
+// Written by a single thread only, so plain relaxed load/store pairs are enough
+struct alignas(64) ThreadSlot {
+    std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters{};
+    std::array<std::array<std::atomic<uint64_t>, BUCKET_COUNT>, HISTOGRAM_COUNT> buckets{};
+    std::array<std::atomic<uint64_t>, HISTOGRAM_COUNT> sumNanoseconds{};
+};
+
+inline void bump(std::atomic<uint64_t>& value, uint64_t amount) {
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+class Registry {
+    private:
+        std::array<ThreadSlot, MAX_THREADS> slots;
+        std::atomic<int> registeredThreads{0};
+        ThreadSlot overflowSlot; // Shared by threads beyond MAX_THREADS, may lose increments
+
+    public:
+        ThreadSlot& threadSlot() {
+            thread_local ThreadSlot* slot = nullptr;
+            if (!slot) {
+                int index = registeredThreads.fetch_add(1);
+                slot = index < MAX_THREADS ? &slots[index] : &overflowSlot;
+            }
+            return *slot;
+        }
+
+        uint64_t counter(Counter counter) const {
+            uint64_t total = overflowSlot.counters[static_cast<int>(counter)].load(std::memory_order_relaxed);
+            for (const ThreadSlot& slot : slots) {
+                total += slot.counters[static_cast<int>(counter)].load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+
+        uint64_t bucket(Histogram histogram, int bucket) const {
+            int h = static_cast<int>(histogram);
+            uint64_t total = overflowSlot.buckets[h][bucket].load(std::memory_order_relaxed);
+            for (const ThreadSlot& slot : slots) {
+                total += slot.buckets[h][bucket].load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+
+        double sumSeconds(Histogram histogram) const {
+            int h = static_cast<int>(histogram);
+            uint64_t total = overflowSlot.sumNanoseconds[h].load(std::memory_order_relaxed);
+            for (const ThreadSlot& slot : slots) {
+                total += slot.sumNanoseconds[h].load(std::memory_order_relaxed);
+            }
+            return total * 1e-9;
+        }
+
+        // Prometheus text exposition format
+        std::string format() const {
+            std::string text;
+            char line[256];
+            for (int i = 0; i < COUNTER_COUNT; ++i) {
+                const CounterInfo& info = COUNTER_INFO[i];
+                if (info.help[0] != '\0') {
+                    std::snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s counter\n", info.name, info.help, info.name);
+                    text += line;
+                }
+                std::snprintf(line, sizeof(line), info.labels[0] ? "%s{%s} %llu\n" : "%s%s %llu\n",
+                              info.name, info.labels, (unsigned long long)counter(static_cast<Counter>(i)));
+                text += line;
+            }
+            for (int h = 0; h < HISTOGRAM_COUNT; ++h) {
+                const CounterInfo& info = HISTOGRAM_INFO[h];
+                Histogram histogram = static_cast<Histogram>(h);
+                std::snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s histogram\n", info.name, info.help, info.name);
+                text += line;
+
+                uint64_t cumulative = 0;
+                for (int b = 0; b < BUCKET_COUNT; ++b) {
+                    cumulative += bucket(histogram, b);
+                    if (b < BUCKET_COUNT - 1) {
+                        std::snprintf(line, sizeof(line), "%s_bucket{le=\"%g\"} %llu\n", info.name, BUCKET_BOUNDS[b], (unsigned long long)cumulative);
+                    } else {
+                        std::snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %llu\n", info.name, (unsigned long long)cumulative);
+                    }
+                    text += line;
+                }
+                std::snprintf(line, sizeof(line), "%s_sum %.9f\n%s_count %llu\n", info.name, sumSeconds(histogram), info.name, (unsigned long long)cumulative);
+                text += line;
+            }
+            return text;
+        }
+};
+
+inline Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+inline void increment(Counter counter, uint64_t amount = 1) {
+    bump(registry().threadSlot().counters[static_cast<int>(counter)], amount);
+}
+
+inline void observe(Histogram histogram, double seconds) {
+    int bucket = 0;
+    while (bucket < BUCKET_COUNT - 1 && seconds > BUCKET_BOUNDS[bucket]) {
+        bucket++;
+    }
+    ThreadSlot& slot = registry().threadSlot();
+    int h = static_cast<int>(histogram);
+    bump(slot.buckets[h][bucket], 1);
+    bump(slot.sumNanoseconds[h], static_cast<uint64_t>(seconds * 1e9));
+}
+
+// Observes the lifetime of the scope
+class ScopedTimer {
+    private:
+        Histogram histogram;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        ScopedTimer(Histogram histogram): histogram(histogram), start(std::chrono::steady_clock::now()) {}
+
+        ~ScopedTimer() {
+            observe(histogram, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+};
+
+// Background thread writing the registry to a file for the node exporter
+// text-file collector. The file is replaced atomically through a rename.
+class TextFileExporter {
+    private:
+        std::string path;
+        std::chrono::seconds interval;
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+        bool stopping = false;
+
+        void writeFile() {
+            std::string temporaryPath = path + ".tmp";
+            {
+                std::ofstream file(temporaryPath, std::ios::trunc);
+                if (!file) return;
+                file << registry().format();
+            }
+            std::rename(temporaryPath.c_str(), path.c_str());
+        }
+
+        // Writes every interval, and a last time on shutdown
+        void run() {
+            std::unique_lock<std::mutex> lock(mutex);
+            bool stop = false;
+            while (!stop) {
+                stop = wakeUp.wait_for(lock, interval, [this] { return stopping; });
+                writeFile();
+            }
+        }
+
+    public:
+        TextFileExporter(const std::string& path, int intervalSeconds = 15)
+            : path(path), interval(intervalSeconds) {
+            worker = std::thread(&TextFileExporter::run, this);
+        }
+
+        ~TextFileExporter() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wakeUp.notify_one();
+            worker.join();
+        }
+};
+
+}
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef NETLINK_H
+#define NETLINK_H
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <random>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+// Non-blocking UDP socket on the loopback interface, talking to one peer port.
+// Loopback stands in for a real network; JitterInjector adds the latency.
+class UdpSocket {
+    private:
+        int fd = -1;
+        sockaddr_in peer{};
+
+        static sockaddr_in loopback(uint16_t port) {
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            return address;
+        }
+
+    public:
+        UdpSocket() {}
+        UdpSocket(const UdpSocket&) = delete;
+        UdpSocket& operator=(const UdpSocket&) = delete;
+
+        ~UdpSocket() {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+
+        // Port 0 picks a free port, see getLocalPort()
+        bool open(uint16_t localPort) {
+            fd = socket(AF_INET, SOCK_DGRAM, 0);
+            if (fd < 0) {
+                std::cerr << "[Error] Cannot create a UDP socket: " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            sockaddr_in address = loopback(localPort);
+            if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+                std::cerr << "[Error] Cannot bind UDP port " << localPort << ": " << std::strerror(errno) << std::endl;
+                close(fd);
+                fd = -1;
+                return false;
+            }
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            return true;
+        }
+
+        void setPeer(uint16_t peerPort) {
+            peer = loopback(peerPort);
+        }
+
+        uint16_t getLocalPort() const {
+            sockaddr_in address{};
+            socklen_t length = sizeof(address);
+            if (fd < 0 || getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) < 0) return 0;
+            return ntohs(address.sin_port);
+        }
+
+        // A full socket buffer drops the datagram, as the network would
+        bool send(const void* data, size_t size) {
+            return fd >= 0 && sendto(fd, data, size, 0, reinterpret_cast<const sockaddr*>(&peer), sizeof(peer)) == static_cast<ssize_t>(size);
+        }
+
+        // Size of the next datagram, or -1 when none is waiting
+        int receive(void* data, size_t capacity) {
+            if (fd < 0) return -1;
+            ssize_t size = recv(fd, data, capacity, 0);
+            return size < 0 ? -1 : static_cast<int>(size);
+        }
+};
+
+// Holds outgoing datagrams back to test against a bad network: a fixed latency,
+// a random jitter on top of it, which also reorders datagrams, and random loss.
+// With everything at zero datagrams go straight through.
+class JitterInjector {
+    private:
+        struct Held {
+            double due;
+            std::vector<uint8_t> bytes;
+        };
+
+        double latency = 0.0, jitter = 0.0, loss = 0.0;
+        std::mt19937 rng;
+        std::vector<Held> held;
+        std::vector<Held> spare; // Released entries, kept so their buffers are reused
+        uint64_t submitted = 0, dropped = 0;
+
+    public:
+        // Seconds of latency and of jitter, loss as a probability
+        JitterInjector(double latency = 0.0, double jitter = 0.0, double loss = 0.0, unsigned seed = 1)
+            : latency(latency), jitter(jitter), loss(loss), rng(seed) {}
+
+        void submit(const void* data, size_t size, double now) {
+            submitted++;
+            if (loss > 0.0 && std::uniform_real_distribution<>(0.0, 1.0)(rng) < loss) {
+                dropped++;
+                return;
+            }
+            double delay = latency + (jitter > 0.0 ? std::uniform_real_distribution<>(0.0, jitter)(rng) : 0.0);
+            if (spare.empty()) {
+                spare.emplace_back();
+            }
+            held.push_back(std::move(spare.back()));
+            spare.pop_back();
+            held.back().due = now + delay;
+            held.back().bytes.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+        }
+
+        // send(data, size) for every datagram due by now, earliest first
+        template <typename Send>
+        void release(double now, Send&& send) {
+            std::sort(held.begin(), held.end(), [](const Held& a, const Held& b) { return a.due < b.due; });
+            size_t due = 0;
+            while (due < held.size() && held[due].due <= now) {
+                send(held[due].bytes.data(), held[due].bytes.size());
+                due++;
+            }
+            for (size_t i = 0; i < due; ++i) {
+                spare.push_back(std::move(held[i]));
+            }
+            held.erase(held.begin(), held.begin() + due);
+        }
+
+        uint64_t getSubmitted() const { return submitted; }
+        uint64_t getDropped() const { return dropped; }
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <glm/glm.hpp>
+
+// Block colours are stored as an index into this table, from the falling piece
+// to every cell of the board. The shaders receive the table once as a uniform.
+namespace palette {
+
+const int SIZE = 16;
+
+// Never a block colour: marks empty cells, and draws grid lines white
+const uint8_t EMPTY = 0;
+
+const std::array<glm::vec3, SIZE> COLORS = {{
+    glm::vec3(1.00f, 1.00f, 1.00f),
+    glm::vec3(0.90f, 0.20f, 0.20f),
+    glm::vec3(0.95f, 0.50f, 0.15f),
+    glm::vec3(0.95f, 0.80f, 0.20f),
+    glm::vec3(0.60f, 0.85f, 0.20f),
+    glm::vec3(0.20f, 0.75f, 0.30f),
+    glm::vec3(0.15f, 0.75f, 0.65f),
+    glm::vec3(0.20f, 0.75f, 0.95f),
+    glm::vec3(0.20f, 0.45f, 0.90f),
+    glm::vec3(0.35f, 0.25f, 0.85f),
+    glm::vec3(0.60f, 0.30f, 0.90f),
+    glm::vec3(0.85f, 0.30f, 0.80f),
+    glm::vec3(0.95f, 0.45f, 0.60f),
+    glm::vec3(0.65f, 0.45f, 0.30f),
+    glm::vec3(0.55f, 0.60f, 0.65f),
+    glm::vec3(0.85f, 0.85f, 0.70f)
+}};
+
+inline glm::vec3 color(uint8_t index) {
+    return COLORS[index % SIZE];
+}
+
+// Any colour but EMPTY
+inline uint8_t randomIndex() {
+    return static_cast<uint8_t>(1 + rand() % (SIZE - 1));
+}
+
+}
+
+#endif
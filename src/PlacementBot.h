@@ -0,0 +1,188 @@
+#ifndef PLACEMENTBOT_H
+#define PLACEMENTBOT_H
+
+#include "Game.h"
+#include "EvalCache.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+// Greedy player for bot and analysis runs: when a piece spawns it tries every distinct
+// orientation at every translation, scores the board each placement leaves (height,
+// holes, bumpiness, layers cleared) and plays the best one straight away.
+//
+// Searches are keyed by Game::getStateHash in an optional EvalCache, so a position
+// any thread or any earlier run has already searched is played from the cache.
+class PlacementBot {
+    private:
+        // Weights of the board features, in the spirit of the usual 2D Tetris heuristics
+        const float WEIGHT_HEIGHT = -0.51f;
+        const float WEIGHT_LINES = 0.76f;
+        const float WEIGHT_HOLES = -0.36f;
+        const float WEIGHT_BUMPINESS = -0.18f;
+        const float LOCK_SECONDS = 1.0f; // Past any lock delay
+
+        EvalCache* cache;
+        Grid scratch;
+        Tetromino piece, placed;
+        std::vector<int> landing;
+        std::vector<int> heights;
+        std::vector<uint64_t> seenBoards;
+        std::vector<std::array<int, 4>> seenShapes;
+
+        uint64_t searches = 0;
+        uint64_t cacheHits = 0;
+        uint64_t candidates = 0;
+
+        static glm::vec3 minCorner(const Tetromino& tetromino) {
+            glm::vec3 minPos = tetromino.getBlocks()[0].getPosition();
+            for (const Block& block : tetromino.getBlocks()) {
+                glm::vec3 pos = block.getPosition();
+                minPos = glm::vec3(std::min(minPos.x, pos.x), std::min(minPos.y, pos.y), std::min(minPos.z, pos.z));
+            }
+            return minPos;
+        }
+
+        // Cells relative to the min corner, sorted: equal for orientations that only differ by a translation
+        static std::array<int, 4> shapeOf(const PieceFootprint& fp) {
+            std::array<int, 4> cells = { -1, -1, -1, -1 };
+            for (int b = 0; b < fp.count; ++b) {
+                cells[b] = (fp.y[b] * 16 + fp.z[b]) * 16 + fp.x[b];
+            }
+            std::sort(cells.begin(), cells.end());
+            return cells;
+        }
+
+        // Higher is better
+        float evaluateBoard(const Grid& board, int lines) {
+            const int width = board.getWidth(), depth = board.getDepth();
+            std::fill(heights.begin(), heights.end(), 0);
+            int cells = 0;
+            // Cells come from the bottom layer up, the last one seen in a column is the highest
+            board.forEachOccupiedCell([&](int x, int y, int z, uint8_t) {
+                heights[z * width + x] = y + 1;
+                cells++;
+            });
+            int aggregate = 0, bumpiness = 0;
+            for (int z = 0; z < depth; ++z) {
+                for (int x = 0; x < width; ++x) {
+                    int h = heights[z * width + x];
+                    aggregate += h;
+                    if (x + 1 < width) bumpiness += std::abs(h - heights[z * width + x + 1]);
+                    if (z + 1 < depth) bumpiness += std::abs(h - heights[(z + 1) * width + x]);
+                }
+            }
+            int holes = aggregate - cells;
+            return WEIGHT_HEIGHT * aggregate + WEIGHT_LINES * lines + WEIGHT_HOLES * holes + WEIGHT_BUMPINESS * bumpiness;
+        }
+
+        Evaluation search(const Game& game) {
+            const Grid& grid = game.getGrid();
+            const int width = grid.getWidth(), depth = grid.getDepth();
+            landing.resize(static_cast<size_t>(width) * depth);
+            heights.resize(static_cast<size_t>(width) * depth);
+            seenBoards.clear();
+            seenShapes.clear();
+
+            Evaluation best;
+            best.score = -std::numeric_limits<float>::infinity();
+            for (int rotationsZ = 0; rotationsZ < 4; ++rotationsZ) {
+                for (int rotationsY = 0; rotationsY < 4; ++rotationsY) {
+                    // The same rotations as Game::rotateTetromino, in the order apply() plays them
+                    piece = game.getCurrentTetromino();
+                    for (int i = 0; i < rotationsZ; ++i) piece.rotate(90.0f, glm::vec3(0, 0, 1));
+                    for (int i = 0; i < rotationsY; ++i) piece.rotate(90.0f, glm::vec3(0, 1, 0));
+                    PieceFootprint fp(piece);
+                    std::array<int, 4> shape = shapeOf(fp);
+                    if (std::find(seenShapes.begin(), seenShapes.end(), shape) != seenShapes.end()) continue;
+                    seenShapes.push_back(shape);
+
+                    int startY = grid.getHeight() - fp.sizeY;
+                    if (startY < 0) continue;
+                    grid.queryLandingLayers(piece, startY, landing.data());
+                    glm::vec3 corner = minCorner(piece);
+                    for (int oz = 0; oz < depth; ++oz) {
+                        for (int ox = 0; ox < width; ++ox) {
+                            int layer = landing[oz * width + ox];
+                            if (layer < 0) continue;
+                            placed = piece;
+                            placed.move(glm::vec3(ox - corner.x, layer - corner.y, oz - corner.z));
+                            // Different orientations can fill the same cells
+                            uint64_t board = grid.hashWith(placed);
+                            if (std::find(seenBoards.begin(), seenBoards.end(), board) != seenBoards.end()) continue;
+                            seenBoards.push_back(board);
+
+                            scratch = grid;
+                            scratch.placeTetromino(placed);
+                            int lines = scratch.clearLines();
+                            float score = evaluateBoard(scratch, lines);
+                            candidates++;
+                            if (score > best.score) {
+                                best.score = score;
+                                best.placement.rotationsZ = static_cast<uint8_t>(rotationsZ);
+                                best.placement.rotationsY = static_cast<uint8_t>(rotationsY);
+                                best.placement.x = static_cast<uint8_t>(ox);
+                                best.placement.z = static_cast<uint8_t>(oz);
+                            }
+                        }
+                    }
+                }
+            }
+            return best;
+        }
+
+        // Moves stop at the first blocked step: the piece then drops where it is
+        static void apply(Game& game, const Placement& placement) {
+            for (int i = 0; i < placement.rotationsZ; ++i) game.rotateTetromino(90.0f, glm::vec3(0, 0, 1));
+            for (int i = 0; i < placement.rotationsY; ++i) game.rotateTetromino(90.0f, glm::vec3(0, 1, 0));
+            glm::vec3 corner = minCorner(game.getCurrentTetromino());
+            int dx = placement.x - static_cast<int>(corner.x);
+            int dz = placement.z - static_cast<int>(corner.z);
+            while (dx != 0 && game.moveTetromino(glm::vec3(dx > 0 ? 1 : -1, 0, 0))) {
+                dx += dx > 0 ? -1 : 1;
+            }
+            while (dz != 0 && game.moveTetromino(glm::vec3(0, 0, dz > 0 ? 1 : -1))) {
+                dz += dz > 0 ? -1 : 1;
+            }
+            game.moveTetrominoToProjectedPosition();
+        }
+
+    public:
+        // Changes to the weights or the search must bump it, which resets the caches filled before
+        static const uint32_t HEURISTIC_VERSION = 1;
+
+        PlacementBot(EvalCache* cache = nullptr): cache(cache) {}
+
+        // Best placement for the piece that just spawned, from the cache when it is there
+        Evaluation choose(const Game& game) {
+            uint64_t state = game.getStateHash();
+            Evaluation evaluation;
+            if (cache && cache->lookup(state, evaluation)) {
+                cacheHits++;
+                return evaluation;
+            }
+            evaluation = search(game);
+            searches++;
+            if (cache) {
+                cache->insert(state, evaluation);
+            }
+            return evaluation;
+        }
+
+        // Plays and locks one piece; returns false once the game is over
+        bool play(Game& game) {
+            if (!game.getIsRunning()) return false;
+            apply(game, choose(game).placement);
+            game.update(LOCK_SECONDS);
+            return game.getIsRunning();
+        }
+
+        uint64_t getSearches() const { return searches; }
+        uint64_t getCacheHits() const { return cacheHits; }
+        // Boards scored by the searches
+        uint64_t getCandidates() const { return candidates; }
+};
+
+#endif
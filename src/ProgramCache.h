@@ -0,0 +1,119 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+// On-disk cache of linked shader programs (glGetProgramBinary / glProgramBinary).
+// Entries are keyed by a hash of the driver strings and both sources, so a driver
+// update or an edited shader simply misses and the program is compiled again.
+class ProgramCache {
+    private:
+        static uint64_t hash(uint64_t h, const char* text) {
+            if (!text) text = "";
+            // FNV-1a, the terminator included so consecutive strings cannot run together
+            do {
+                h = (h ^ static_cast<unsigned char>(*text)) * 1099511628211ull;
+            } while (*text++);
+            return h;
+        }
+
+        static std::string pathFor(const char* vertexSrc, const char* fragmentSrc) {
+            uint64_t h = 1469598103934665603ull;
+            h = hash(h, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+            h = hash(h, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+            h = hash(h, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+            h = hash(h, vertexSrc);
+            h = hash(h, fragmentSrc);
+            char name[32];
+            std::snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)h);
+            return std::string(DIRECTORY) + name;
+        }
+
+        static bool isSupported() {
+            if (!GLEW_ARB_get_program_binary && !GLEW_VERSION_4_1) {
+                return false;
+            }
+            GLint formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            return formats > 0;
+        }
+
+    public:
+        static constexpr const char* DIRECTORY = "./shader_cache";
+
+        struct Stats {
+            int hits = 0;
+            int misses = 0;
+        };
+
+        static Stats& stats() {
+            static Stats instance;
+            return instance;
+        }
+
+        // Linked program from the cache, or 0 when it is missing or the driver rejects the binary
+        static GLuint load(const char* vertexSrc, const char* fragmentSrc) {
+            if (!isSupported()) return 0;
+
+            std::ifstream file(pathFor(vertexSrc, fragmentSrc), std::ios::binary);
+            GLenum format = 0;
+            if (!file || !file.read(reinterpret_cast<char*>(&format), sizeof(format))) {
+                stats().misses++;
+                return 0;
+            }
+            std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+            GLuint program = glCreateProgram();
+            glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
+            GLint linked = GL_FALSE;
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            if (!linked) {
+                glDeleteProgram(program);
+                stats().misses++;
+                return 0;
+            }
+            stats().hits++;
+            return program;
+        }
+
+        // Must be called before glLinkProgram so the driver keeps the binary around
+        static void prepare(GLuint program) {
+            if (isSupported()) {
+                glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            }
+        }
+
+        // Writes a freshly linked program to the cache, replacing the file atomically
+        static void store(GLuint program, const char* vertexSrc, const char* fragmentSrc) {
+            if (!isSupported()) return;
+
+            GLint linked = GL_FALSE, length = 0;
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+            if (!linked || length <= 0) return;
+
+            std::vector<char> binary(length);
+            GLenum format = 0;
+            glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+            mkdir(DIRECTORY, 0755);
+            std::string path = pathFor(vertexSrc, fragmentSrc);
+            std::string temporaryPath = path + ".tmp";
+            {
+                std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+                if (!file) return;
+                file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+                file.write(binary.data(), binary.size());
+            }
+            std::rename(temporaryPath.c_str(), path.c_str());
+        }
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef REFERENCEMODEL_H
+#define REFERENCEMODEL_H
+
+#include "Tetromino.h"
+#include <vector>
+
+// Deliberately naive model of the board rules: collisions, locking, line clears
+// and scoring. The soak runner plays the same moves on it and on Game to catch
+// any divergence after optimisations of Grid or Game. Keep it obvious, not fast.
+class ReferenceModel {
+    private:
+        int width, height, depth;
+        // layers[y][z * width + x]; a cleared layer is erased and an empty one added on top
+        std::vector<std::vector<bool>> layers;
+        int score = 0;
+        int linesCleared = 0;
+        int level = 0;
+
+        static int cellOf(float coordinate) {
+            return static_cast<int>(coordinate);
+        }
+
+    public:
+        ReferenceModel(int width, int height, int depth): width(width), height(height), depth(depth) {
+            reset();
+        }
+
+        void reset() {
+            layers.assign(height, std::vector<bool>(width * depth, false));
+            score = 0;
+            linesCleared = 0;
+            level = 0;
+        }
+
+        bool isCellOccupied(int x, int y, int z) const {
+            return layers[y][z * width + x];
+        }
+
+        bool collides(const Tetromino& tetromino) const {
+            for (const Block& block : tetromino.getBlocks()) {
+                int x = cellOf(block.getPosition().x);
+                int y = cellOf(block.getPosition().y);
+                int z = cellOf(block.getPosition().z);
+                if (x < 0 || x >= width || y < 0 || y >= height || z < 0 || z >= depth) {
+                    return true;
+                }
+                if (isCellOccupied(x, y, z)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Lowest position reachable by moving straight down
+        Tetromino drop(Tetromino tetromino) const {
+            while (true) {
+                Tetromino lower = tetromino;
+                lower.move(glm::vec3(0, -1, 0));
+                if (collides(lower)) {
+                    return tetromino;
+                }
+                tetromino = lower;
+            }
+        }
+
+        // Locks the piece, clears full layers and scores them. Returns the number of layers cleared.
+        int lock(const Tetromino& tetromino) {
+            for (const Block& block : tetromino.getBlocks()) {
+                layers[cellOf(block.getPosition().y)][cellOf(block.getPosition().z) * width + cellOf(block.getPosition().x)] = true;
+            }
+
+            int cleared = 0;
+            for (int y = height - 1; y >= 0; --y) {
+                bool full = true;
+                for (bool cell : layers[y]) {
+                    full = full && cell;
+                }
+                if (full) {
+                    layers.erase(layers.begin() + y);
+                    layers.push_back(std::vector<bool>(width * depth, false));
+                    cleared++;
+                }
+            }
+
+            const int POINTS[4] = { 40, 100, 300, 1200 };
+            if (cleared >= 1 && cleared <= 4) {
+                score += POINTS[cleared - 1] * (level + 1);
+            }
+            linesCleared += cleared;
+            level = linesCleared / 10;
+            return cleared;
+        }
+
+        int getScore() const { return score; }
+        int getLinesCleared() const { return linesCleared; }
+        int getLevel() const { return level; }
+};
+
+#endif
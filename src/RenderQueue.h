@@ -0,0 +1,197 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "Trace.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// One draw of a render pass. Everything the draw needs bound is packed into the sort key,
+// the most expensive state change first, so sorting the commands of a pass puts the draws
+// that share a state next to each other:
+//   bit 63      blending: opaque draws first, blended ones over them
+//   bits 56-62  program
+//   bits 40-55  vertex array
+//   bits 24-39  texture, 0 for none
+//   bits 16-23  colorIndex, so the draws of a colour are grouped within a state
+//   bits 0-15   submission order, so draws with the same state keep their order
+struct RenderCommand {
+    uint64_t key = 0;
+    GLenum mode = GL_TRIANGLES;
+    GLint first = 0;        // First vertex, or first index of an indexed draw
+    GLsizei count = 0;
+    bool indexed = false;   // GL_UNSIGNED_INT indices of the bound vertex array
+    uint8_t colorIndex = 0; // Per-draw uniforms, for the programs that have them
+    int16_t cell[3] = { 0, 0, 0 };
+};
+
+// GL calls of a frame: state changes (binds, blending, uniforms) and draws
+struct RenderStats {
+    uint32_t commands = 0;
+    uint32_t stateChanges = 0;
+    uint32_t drawCalls = 0;
+};
+
+// Collects the commands of a pass and issues them sorted, with only the GL state changes
+// that differ from the previous command. Programs, vertex arrays and textures are
+// registered once and referred to by small indices in the keys.
+class RenderQueue {
+    private:
+        struct ProgramInfo {
+            GLuint id;
+            bool usesCamera;
+            GLint projection, view, cell, colorIndex;
+            uint64_t cameraUploaded; // cameraVersion last sent to this program
+        };
+
+        std::vector<ProgramInfo> programs;
+        std::vector<GLuint> vertexArrays;
+        std::vector<GLuint> textures;
+        std::vector<RenderCommand> commands;
+        uint16_t sequence = 0;
+
+        glm::mat4 projection = glm::mat4(1.0f), view = glm::mat4(1.0f);
+        uint64_t cameraVersion = 1;
+
+        RenderStats current, lastFrame;
+
+    public:
+        // usesCamera: the program gets the "projection" and "view" of setCamera(). Per-draw
+        // "cell" (vec3) and "colorIndex" (int) uniforms are set when the program has them.
+        int addProgram(GLuint id, bool usesCamera) {
+            ProgramInfo info = { id, usesCamera, glGetUniformLocation(id, "projection"), glGetUniformLocation(id, "view"),
+                                 glGetUniformLocation(id, "cell"), glGetUniformLocation(id, "colorIndex"), 0 };
+            programs.push_back(info);
+            return static_cast<int>(programs.size()) - 1;
+        }
+
+        int addVertexArray(GLuint id) {
+            vertexArrays.push_back(id);
+            return static_cast<int>(vertexArrays.size()) - 1;
+        }
+
+        // Texture indices start at 1, 0 means none
+        int addTexture(GLuint id) {
+            textures.push_back(id);
+            return static_cast<int>(textures.size());
+        }
+
+        static uint64_t stateKey(bool blend, int program, int vertexArray, int texture = 0) {
+            return (static_cast<uint64_t>(blend) << 63) | (static_cast<uint64_t>(program & 0x7f) << 56)
+                 | (static_cast<uint64_t>(vertexArray & 0xffff) << 40) | (static_cast<uint64_t>(texture & 0xffff) << 24);
+        }
+
+        // Only sent to the programs again when it changes
+        void setCamera(const glm::mat4& newProjection, const glm::mat4& newView) {
+            if (std::memcmp(&newProjection, &projection, sizeof(projection)) == 0 && std::memcmp(&newView, &view, sizeof(view)) == 0) return;
+            projection = newProjection;
+            view = newView;
+            cameraVersion++;
+        }
+
+        // command.key holds the state from stateKey(); its low bits are overwritten with
+        // command.colorIndex and the submission order
+        void submit(RenderCommand command) {
+            command.key = (command.key & ~0xffffffull) | (static_cast<uint64_t>(command.colorIndex) << 16) | sequence++;
+            commands.push_back(command);
+        }
+
+        // Draws and empties the queue. The state left by other renderers is unknown, so the
+        // first command binds everything it needs.
+        void flush() {
+            TRACE_SCOPE("RenderQueue::flush");
+            if (commands.empty()) return;
+            std::sort(commands.begin(), commands.end(), [](const RenderCommand& a, const RenderCommand& b) { return a.key < b.key; });
+
+            int blend = -1, program = -1, vertexArray = -1, texture = 0;
+            int colorIndex = -1;
+            int16_t cell[3] = { 0, 0, 0 };
+            bool cellSet = false;
+            for (const RenderCommand& command : commands) {
+                int commandBlend = static_cast<int>(command.key >> 63);
+                int commandProgram = static_cast<int>((command.key >> 56) & 0x7f);
+                int commandVertexArray = static_cast<int>((command.key >> 40) & 0xffff);
+                int commandTexture = static_cast<int>((command.key >> 24) & 0xffff);
+
+                if (commandBlend != blend) {
+                    if (commandBlend) {
+                        glEnable(GL_BLEND);
+                        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                        current.stateChanges += 2;
+                    } else {
+                        glDisable(GL_BLEND);
+                        current.stateChanges++;
+                    }
+                    blend = commandBlend;
+                }
+                ProgramInfo& info = programs[commandProgram];
+                if (commandProgram != program) {
+                    glUseProgram(info.id);
+                    current.stateChanges++;
+                    if (info.usesCamera && info.cameraUploaded != cameraVersion) {
+                        glUniformMatrix4fv(info.projection, 1, GL_FALSE, glm::value_ptr(projection));
+                        glUniformMatrix4fv(info.view, 1, GL_FALSE, glm::value_ptr(view));
+                        info.cameraUploaded = cameraVersion;
+                        current.stateChanges += 2;
+                    }
+                    program = commandProgram;
+                    colorIndex = -1;
+                    cellSet = false;
+                }
+                if (commandVertexArray != vertexArray) {
+                    glBindVertexArray(vertexArrays[commandVertexArray]);
+                    current.stateChanges++;
+                    vertexArray = commandVertexArray;
+                }
+                // Draws without a texture do not sample, whatever is bound can stay
+                if (commandTexture != 0 && commandTexture != texture) {
+                    if (texture == 0) {
+                        glActiveTexture(GL_TEXTURE0);
+                        current.stateChanges++;
+                    }
+                    glBindTexture(GL_TEXTURE_2D, textures[commandTexture - 1]);
+                    current.stateChanges++;
+                    texture = commandTexture;
+                }
+                if (info.colorIndex >= 0 && command.colorIndex != colorIndex) {
+                    glUniform1i(info.colorIndex, command.colorIndex);
+                    current.stateChanges++;
+                    colorIndex = command.colorIndex;
+                }
+                if (info.cell >= 0 && (!cellSet || std::memcmp(cell, command.cell, sizeof(cell)) != 0)) {
+                    glUniform3f(info.cell, command.cell[0], command.cell[1], command.cell[2]);
+                    current.stateChanges++;
+                    std::memcpy(cell, command.cell, sizeof(cell));
+                    cellSet = true;
+                }
+
+                if (command.indexed) {
+                    glDrawElements(command.mode, command.count, GL_UNSIGNED_INT, reinterpret_cast<const void*>(static_cast<uintptr_t>(command.first) * sizeof(GLuint)));
+                } else {
+                    glDrawArrays(command.mode, command.first, command.count);
+                }
+                current.drawCalls++;
+            }
+            glBindVertexArray(0);
+            current.stateChanges++;
+            current.commands += static_cast<uint32_t>(commands.size());
+            commands.clear();
+            sequence = 0;
+        }
+
+        // Closes the statistics of a frame
+        void endFrame() {
+            lastFrame = current;
+            current = RenderStats();
+        }
+
+        const RenderStats& getLastFrameStats() const {
+            return lastFrame;
+        }
+};
+
+#endif
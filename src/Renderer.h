@@ -4,13 +4,46 @@
 #include "Game.h"
 #include "Shader.h"
 #include "TextShader.h"
+#include "RenderQueue.h"
+#include "Trace.h"
 
+// Every draw of a frame goes through a RenderQueue: the scene is submitted and flushed by
+// renderGame, the text by flushText, each sorted so that only the needed state changes are issued.
 class Renderer {
     private:
         Shader blockShader;
+        GridLineShader gridShader;
         TextShader textShader;
+        RenderQueue queue;
+        int blockProgram, gridProgram;
         GLuint cubeVAO = 0, cubeVBO = 0, cubeEBO = 0;
         int cubeIndexCount = 36; // 6 caras * 2 triángulos por cara * 3 vértices por triángulo
+        GLuint gridVAO = 0, gridVBO = 0;
+        int gridVertexCount = 0;
+        uint64_t blockState = 0, gridState = 0; // RenderQueue keys, set once the vertex arrays exist
+
+        // HUD strings, only rebuilt when the game reports a score or level change
+        GameEventReader hudEvents;
+        std::string scoreText;
+        std::string levelText;
+        bool hudDirty = true;
+
+        void updateHudText(const Game& game) {
+            GameEvent event;
+            while (hudEvents.poll(game.getEvents(), event)) {
+                if (event.type == GameEventType::GameStarted || event.type == GameEventType::LayersCleared || event.type == GameEventType::LevelUp) {
+                    hudDirty = true;
+                }
+            }
+            if (hudEvents.checkOverflow()) {
+                hudDirty = true;
+            }
+            if (hudDirty) {
+                scoreText = "Score: " + std::to_string(game.getScore());
+                levelText = "Level: " + std::to_string(game.getLevel());
+                hudDirty = false;
+            }
+        }
 
 
         void initializeCubeVAO() {
@@ -60,88 +93,155 @@ class Renderer {
 
                 glBindBuffer(GL_ARRAY_BUFFER, 0);
                 glBindVertexArray(0);
+                // Opaque, drawn before anything blended
+                blockState = RenderQueue::stateKey(false, blockProgram, queue.addVertexArray(cubeVAO));
             }
         }
 
-        void renderBlocksInGrille(const Grid& grid, const glm::mat4& projection, const glm::mat4& view) {
-            initializeCubeVAO();
-            blockShader.use();
-            blockShader.setUniformMatrix4fv("projection", projection);
-            blockShader.setUniformMatrix4fv("view", view);
-
-            for (int x = 0; x < grid.getWidth(); ++x) {
-                for (int y = 0; y < grid.getHeight(); ++y) {
-                    for (int z = 0; z < grid.getDepth(); ++z) {
-                        if (grid.isCellOccupied(x, y, z)) {
-                            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, z));
-                            blockShader.setUniformMatrix4fv("model", model);
-
-                            glm::vec3 color = grid.getCellColor(x, y, z); 
-
-                            blockShader.setUniform3f("blockColor", color.x, color.y, color.z);
-                            blockShader.setUniform1i("isGRID", false);
-
-                            // Renderizar un cubo en la posición actual
-                            glBindVertexArray(cubeVAO); // Asegúrate de usar un VAO compartido o inicializado para cubos
-                            glDrawElements(GL_TRIANGLES, cubeIndexCount, GL_UNSIGNED_INT, 0);
-                            glBindVertexArray(0);
-                        }
-                    }
-                }
+        // Generate vertices for a 3D grid based on width, height, and depth
+        std::vector<float> generateGridVertices(int width, int height, int depth) {
+            std::vector<float> vertices;
+
+            for (int y = 0; y <= height; ++y) {
+                // Líneas horizontales
+                vertices.insert(vertices.end(), { 0, (float)y, 0, (float)width, (float)y, 0 });
+                vertices.insert(vertices.end(), { 0, (float)y, 0, 0, (float)y, (float)depth });
+            }
+
+            for (int z = 0; z <= depth; ++z) {
+                // Líneas verticales
+                vertices.insert(vertices.end(), { 0, 0, (float)z, 0, (float)height, (float)z });
+                vertices.insert(vertices.end(), { 0, 0, (float)z, (float)width, 0, (float)z });
+            }
+
+            for (int x = 0; x <= width; ++x) {
+                vertices.insert(vertices.end(), { (float)x, 0, 0, (float)x, (float)height, 0 });
+                vertices.insert(vertices.end(), { (float)x, 0, 0, (float)x, 0, (float)depth });
             }
+
+            return vertices;
+        }
+
+        // The grid lines live here rather than in Grid, so the simulation never needs a GL context
+        void initializeGridVAO(const Grid& grid) {
+            if (gridVAO != 0) return;
+
+            std::vector<float> vertices = generateGridVertices(grid.getWidth(), grid.getHeight(), grid.getDepth());
+            gridVertexCount = vertices.size() / 3;
+
+            glGenVertexArrays(1, &gridVAO);
+            glBindVertexArray(gridVAO);
+
+            glGenBuffers(1, &gridVBO);
+            glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
+            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
+
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+            // The lines fade out with their height
+            gridState = RenderQueue::stateKey(true, gridProgram, queue.addVertexArray(gridVAO));
+        }
+
+        void submitCube(int x, int y, int z, uint8_t colorIndex) {
+            RenderCommand command;
+            command.key = blockState;
+            command.count = cubeIndexCount;
+            command.indexed = true;
+            command.colorIndex = colorIndex;
+            command.cell[0] = static_cast<int16_t>(x);
+            command.cell[1] = static_cast<int16_t>(y);
+            command.cell[2] = static_cast<int16_t>(z);
+            queue.submit(command);
         }
 
-        void renderTetromino(const Tetromino& tetromino, const glm::mat4& projection, const glm::mat4& view) {
-            blockShader.use();
-            blockShader.setUniformMatrix4fv("projection", projection);
-            blockShader.setUniformMatrix4fv("view", view);
+        void renderBlocksInGrille(const Grid& grid) {
+            TRACE_SCOPE("Renderer::renderBlocksInGrille");
+            initializeCubeVAO();
+            // Only the occupied cells are visited, whatever the storage of the grid
+            grid.forEachOccupiedCell([&](int x, int y, int z, uint8_t colorIndex) {
+                submitCube(x, y, z, colorIndex);
+            });
+        }
 
+        void renderTetromino(const Tetromino& tetromino) {
+            initializeCubeVAO();
             for (const Block& block : tetromino.getBlocks()) {
-                glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(block.getPosition()));
-                blockShader.setUniformMatrix4fv("model", model);
-                block.draw(blockShader);
+                glm::vec3 pos = block.getPosition();
+                submitCube(static_cast<int>(pos.x), static_cast<int>(pos.y), static_cast<int>(pos.z), block.getColorIndex());
             }
         }
 
-        void renderGrid(const Grid& grid, const glm::mat4& projection, const glm::mat4& view) {
-            blockShader.use();
-            blockShader.setUniformMatrix4fv("projection", projection);
-            blockShader.setUniformMatrix4fv("view", view);
-
-            // Renderizar la grilla aquí
-            grid.draw(blockShader);
+        void renderGrid(const Grid& grid) {
+            initializeGridVAO(grid);
+            RenderCommand command;
+            command.key = gridState;
+            command.mode = GL_LINES;
+            command.count = gridVertexCount;
+            queue.submit(command);
+        }
 
+        void renderText(const char* text, float x, float y, float scale, glm::vec3 color) {
+            textShader.queueText(text, x, y, scale, color);
         }
 
-        void renderText(const std::string& text, float x, float y, float scale, glm::vec3 color) {
+    public:
+        // The text is drawn from the glyph atlas of ui
+        explicit Renderer(const UIRenderer& ui): blockShader(), gridShader(), textShader(ui) {
+            blockProgram = queue.addProgram(blockShader.ID, true);
+            gridProgram = queue.addProgram(gridShader.ID, true);
+            textShader.attach(queue);
             textShader.use();
             textShader.setMat4("projection", glm::ortho(0.0f, 1600.0f, 0.0f, 1200.0f));
-            textShader.setVec3("textColor", color);
-            textShader.renderText(text, x, y, scale, color);
         }
 
-    public:
-        Renderer(): blockShader(), textShader() {}
-
+        // Queues one line of the debug overlay, line 0 being the top of the screen
+        void renderDebugText(const char* text, int line) {
+            renderText(text, 20.0f, 1160.0f - line * 30.0f, 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+        }
 
+        // The 3D scene only, so that it can be drawn at another resolution than the HUD
         void renderGame(const Game& game, const glm::mat4& projection, const glm::mat4& view) {
+            TRACE_SCOPE("Renderer::renderGame");
+            queue.setCamera(projection, view);
             // Renderizar la grilla
-            renderGrid(game.getGrid(), projection, view);
+            renderGrid(game.getGrid());
 
-            renderBlocksInGrille(game.getGrid(), projection, view);
+            renderBlocksInGrille(game.getGrid());
 
             // Renderizar el Tetromino actual
-            renderTetromino(game.getCurrentTetromino(), projection, view);
+            renderTetromino(game.getCurrentTetromino());
 
             // Renderizar el siguiente Tetromino
-            renderTetromino(game.getNextTetromino(), projection, view);
+            renderTetromino(game.getNextTetromino());
 
             // Renderizar el Tetromino proyectado
-            renderTetromino(game.getProjectedTetromino(game.getCurrentTetromino()), projection, view);
+            renderTetromino(game.getProjectedTetromino());
+
+            queue.flush();
+        }
 
+        // Queues the score and level, drawn at the native resolution by flushText
+        void renderHud(const Game& game) {
             // Renderizar puntaje y nivel
-            renderText("Score: " + std::to_string(game.getScore()), 1200.0f, 1100.0f, 1.0f, glm::vec3(1.0f, 1.0f, 1.0f));
-            renderText("Level: " + std::to_string(game.getLevel()), 1200.0f, 1000.0f, 1.0f, glm::vec3(1.0f, 1.0f, 1.0f));
+            updateHudText(game);
+            renderText(scoreText.c_str(), 1200.0f, 1100.0f, 1.0f, glm::vec3(1.0f, 1.0f, 1.0f));
+            renderText(levelText.c_str(), 1200.0f, 1000.0f, 1.0f, glm::vec3(1.0f, 1.0f, 1.0f));
+        }
+
+        // Draws the HUD and debug text queued this frame in one draw, and ends the frame
+        void flushText() {
+            TRACE_SCOPE("Renderer::flushText");
+            textShader.submit(queue);
+            queue.flush();
+            textShader.clear();
+            queue.endFrame();
+        }
+
+        // GL calls of the previous frame
+        const RenderStats& getRenderStats() const {
+            return queue.getLastFrameStats();
         }
 };
 #endif
\ No newline at end of file
@@ -6,47 +6,35 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/gtc/type_ptr.hpp>
+#include "Palette.h"
+#include "ProgramCache.h"
 
 class Shader{
     private:
-        // Vertex shader: Transforms vertex positions and passes fragment position to the fragment shader
+        // Vertex shader: Moves the unit cube to the cell of the Block and transforms it to clip space
         const char* vertexShaderSource = R"(
         #version 330 core
         layout (location = 0) in vec3 aPos;
 
-
-        uniform mat4 model;      // Model matrix
+        uniform vec3 cell;       // Cell of the Block
         uniform mat4 projection; // Projection matrix
         uniform mat4 view;       // View (camera) matrix
 
-        out vec3 FragPos; // Pass the position to the fragment shader
-        out float FragHeight; // Pass the height to the fragment shader
-
         void main() {
-            gl_Position = projection * view * model * vec4(aPos, 1.0);  // Transform to clip space
-            FragPos = vec3(model * vec4(aPos, 1.0));                   // Transform the position
-            FragHeight = aPos.y;                                       // Set the height
+            gl_Position = projection * view * vec4(aPos + cell, 1.0);  // Transform to clip space
         }
         )";
 
-        // Fragment shader: Colors the grid lines with transparency based on their height
+        // Fragment shader: Colors the Block from the palette. The grid lines have their own program, see GridLineShader
         const char* fragmentShaderSource = R"(
         #version 330 core
         out vec4 FragColor;  // Output color of the fragment
 
-        uniform vec3 blockColor; // Color of the Block
-        uniform bool isGRID; // Color of the Block
-
-        in vec3 FragPos;  // Position of the fragment
-        in float FragHeight; // Height of the fragment
+        uniform vec3 palette[16]; // Block colours, see Palette.h
+        uniform int colorIndex;   // Palette index of the Block
 
         void main() {
-            if(isGRID){
-                float alpha = 1.0 - clamp(abs(FragHeight) / 18.0, 0.0, 1.0);  // Calculate transparency based on height
-                FragColor = vec4(1.0, 1.0, 1.0, alpha);  // Set the color of the fragment
-            }else{
-                FragColor = vec4(blockColor,1.0);  // Set the color of the fragment
-            }
+            FragColor = vec4(palette[colorIndex], 1.0);  // Set the color of the fragment
         }
         )";
 
@@ -67,17 +55,31 @@ class Shader{
                 }
             }
         }
+    protected:
+        // For programs that bring their own sources instead of the block shader
+        Shader(const char* vertexSrc, const char* fragmentSrc){
+            ID = createShaderProgram(vertexSrc, fragmentSrc);
+        }
+
     public:
         GLuint ID;
 
         Shader(){
             ID = createShaderProgram(vertexShaderSource, fragmentShaderSource);
+            use();
+            setPalette();
         }
         GLuint getShaderID(){
             return ID;
         }
 
         GLuint createShaderProgram(const char* vertexSrc, const char* fragmentSrc) {
+            // Reuse the binary linked by a previous run when the driver accepts it
+            GLuint cachedProgram = ProgramCache::load(vertexSrc, fragmentSrc);
+            if (cachedProgram) {
+                return cachedProgram;
+            }
+
             // Compile the vertex shader
             GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
             glShaderSource(vertexShader, 1, &vertexSrc, nullptr);
@@ -94,8 +96,10 @@ class Shader{
             GLuint shaderProgram = glCreateProgram();
             glAttachShader(shaderProgram, vertexShader);
             glAttachShader(shaderProgram, fragmentShader);
+            ProgramCache::prepare(shaderProgram);
             glLinkProgram(shaderProgram);
             checkCompileErrors(shaderProgram, "PROGRAM");
+            ProgramCache::store(shaderProgram, vertexSrc, fragmentSrc);
 
             // Clean up the individual shaders as they are no longer needed
             glDeleteShader(vertexShader);
@@ -112,18 +116,28 @@ class Shader{
             glUseProgram(ID);
         }
 
-        void setUniformMatrix4fv(const std::string& name, glm::mat4 matrix) const {
-            GLuint loc = glGetUniformLocation(ID, name.c_str());
+        void setUniformMatrix4fv(const char* name, glm::mat4 matrix) const {
+            GLuint loc = glGetUniformLocation(ID, name);
             glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(matrix));
         }
 
-        void setUniform3f(const std::string& name, float x, float y, float z) const {
-            GLuint loc = glGetUniformLocation(ID, name.c_str());
+        void setUniform3f(const char* name, float x, float y, float z) const {
+            GLuint loc = glGetUniformLocation(ID, name);
             glUniform3f(loc, x, y, z);
         }
 
-        void setUniform1i(const std::string& name, int value) const {
-            GLuint loc = glGetUniformLocation(ID, name.c_str());
+        void setUniform3fv(const char* name, int count, const float* values) const {
+            GLuint loc = glGetUniformLocation(ID, name);
+            glUniform3fv(loc, count, values);
+        }
+
+        // Uploads palette::COLORS to the "palette" uniform array, once per program is enough
+        void setPalette() const {
+            setUniform3fv("palette", palette::SIZE, &palette::COLORS[0].x);
+        }
+
+        void setUniform1i(const char* name, int value) const {
+            GLuint loc = glGetUniformLocation(ID, name);
             glUniform1i(loc, value);
         }
     
@@ -132,4 +146,37 @@ class Shader{
         }
 };
 
+// Grid lines of the board, fading out with their height
+class GridLineShader : public Shader {
+    private:
+        static constexpr const char* GRID_VERTEX_SHADER = R"(
+        #version 330 core
+        layout (location = 0) in vec3 aPos;
+
+        uniform mat4 projection;
+        uniform mat4 view;
+
+        out float FragHeight;
+
+        void main() {
+            gl_Position = projection * view * vec4(aPos, 1.0);
+            FragHeight = aPos.y;
+        }
+        )";
+
+        static constexpr const char* GRID_FRAGMENT_SHADER = R"(
+        #version 330 core
+        in float FragHeight;
+        out vec4 FragColor;
+
+        void main() {
+            float alpha = 1.0 - clamp(abs(FragHeight) / 18.0, 0.0, 1.0);  // Calculate transparency based on height
+            FragColor = vec4(1.0, 1.0, 1.0, alpha);
+        }
+        )";
+
+    public:
+        GridLineShader(): Shader(GRID_VERTEX_SHADER, GRID_FRAGMENT_SHADER) {}
+};
+
 #endif
\ No newline at end of file
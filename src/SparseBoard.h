@@ -0,0 +1,212 @@
+#ifndef SPARSEBOARD_H
+#define SPARSEBOARD_H
+
+#include "Block.h"
+#include "Palette.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Board storage for very large boards, where nearly all the volume is air above
+// the stack. Each layer is cut into 8x8 tiles over x and z; a tile holds a
+// 64-bit occupancy mask and the palette index of its cells. Only tiles with
+// blocks exist, in a shared pool, and only layers with blocks have a tile
+// directory, so memory follows the blocks actually placed.
+class SparseBoard {
+    private:
+        static constexpr int TILE = 8;
+        static constexpr int32_t NO_TILE = -1;
+
+        struct Tile {
+            uint64_t mask = 0;              // Bit (z % 8) * 8 + (x % 8)
+            std::array<uint8_t, 64> colors; // Only meaningful where the mask bit is set
+        };
+
+        int width = 0, height = 0, depth = 0;
+        int tilesX = 0, tilesZ = 0;
+
+        std::vector<Tile> pool;
+        std::vector<int32_t> freeTiles;
+        // Pool index of every tile of a layer, tz * tilesX + tx; empty for a layer without blocks
+        std::vector<std::vector<int32_t>> layers;
+        // Directories of cleared layers, kept for reuse so that clearing and refilling layers does not allocate
+        std::vector<std::vector<int32_t>> spareDirectories;
+
+        static int bitOf(int x, int z) {
+            return (z & (TILE - 1)) * TILE + (x & (TILE - 1));
+        }
+
+        int tileSlot(int x, int z) const {
+            return (z / TILE) * tilesX + x / TILE;
+        }
+
+        const Tile* findTile(int x, int y, int z) const {
+            const std::vector<int32_t>& directory = layers[y];
+            if (directory.empty()) return nullptr;
+            int32_t index = directory[tileSlot(x, z)];
+            return index == NO_TILE ? nullptr : &pool[index];
+        }
+
+        Tile& tileAt(int x, int y, int z) {
+            std::vector<int32_t>& directory = layers[y];
+            if (directory.empty()) {
+                if (!spareDirectories.empty()) {
+                    directory.swap(spareDirectories.back());
+                    spareDirectories.pop_back();
+                }
+                directory.assign(static_cast<size_t>(tilesX) * tilesZ, NO_TILE);
+            }
+            int32_t& index = directory[tileSlot(x, z)];
+            if (index == NO_TILE) {
+                if (!freeTiles.empty()) {
+                    index = freeTiles.back();
+                    freeTiles.pop_back();
+                    pool[index].mask = 0;
+                } else {
+                    index = static_cast<int32_t>(pool.size());
+                    pool.push_back(Tile());
+                }
+            }
+            return pool[index];
+        }
+
+        // Returns the tiles of layer y to the pool and keeps its directory for reuse
+        void releaseLayer(int y) {
+            std::vector<int32_t>& directory = layers[y];
+            for (int32_t index : directory) {
+                if (index != NO_TILE) {
+                    freeTiles.push_back(index);
+                }
+            }
+            if (!directory.empty()) {
+                spareDirectories.push_back(std::vector<int32_t>());
+                spareDirectories.back().swap(directory);
+            }
+        }
+
+        bool inside(int x, int y, int z) const {
+            return x >= 0 && x < width && y >= 0 && y < height && z >= 0 && z < depth;
+        }
+
+    public:
+        SparseBoard() {}
+        SparseBoard(int width, int height, int depth)
+            : width(width), height(height), depth(depth), tilesX((width + TILE - 1) / TILE), tilesZ((depth + TILE - 1) / TILE), layers(height) {}
+
+        bool isOccupied(int x, int y, int z) const {
+            const Tile* tile = findTile(x, y, z);
+            return tile && ((tile->mask >> bitOf(x, z)) & 1);
+        }
+
+        uint8_t colorAt(int x, int y, int z) const {
+            const Tile* tile = findTile(x, y, z);
+            int bit = bitOf(x, z);
+            return tile && ((tile->mask >> bit) & 1) ? tile->colors[bit] : palette::EMPTY;
+        }
+
+        // Returns true when the cell was free
+        bool set(int x, int y, int z, uint8_t colorIndex) {
+            Tile& tile = tileAt(x, y, z);
+            int bit = bitOf(x, z);
+            if ((tile.mask >> bit) & 1) return false;
+            tile.mask |= 1ull << bit;
+            tile.colors[bit] = colorIndex;
+            return true;
+        }
+
+        bool collides(const std::vector<Block>& blocks) const {
+            for (const Block& block : blocks) {
+                glm::vec3 pos = block.getPosition();
+                int x = static_cast<int>(pos.x);
+                int y = static_cast<int>(pos.y);
+                int z = static_cast<int>(pos.z);
+                if (!inside(x, y, z) || isOccupied(x, y, z)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Same contract as GridKernels::dropDistance; layers without blocks are skipped at the cost of one test
+        int dropDistance(const std::vector<Block>& blocks) const {
+            int distance = height;
+            for (const Block& block : blocks) {
+                glm::vec3 pos = block.getPosition();
+                int x = static_cast<int>(pos.x);
+                int y = static_cast<int>(pos.y);
+                int z = static_cast<int>(pos.z);
+                if (!inside(x, y, z)) {
+                    return 0;
+                }
+                int free = 0;
+                for (int ny = y - 1; ny >= 0 && free < distance && !isOccupied(x, ny, z); --ny) {
+                    free++;
+                }
+                distance = std::min(distance, free);
+            }
+            return distance;
+        }
+
+        // Occupancy of row (y, z) with one bit per x, for boards up to 64 wide
+        uint64_t rowMask(int y, int z) const {
+            const std::vector<int32_t>& directory = layers[y];
+            if (directory.empty()) return 0;
+            uint64_t row = 0;
+            int shift = (z & (TILE - 1)) * TILE;
+            for (int tx = 0; tx < tilesX && tx * TILE < 64; ++tx) {
+                int32_t index = directory[(z / TILE) * tilesX + tx];
+                if (index != NO_TILE) {
+                    row |= ((pool[index].mask >> shift) & 0xFF) << (tx * TILE);
+                }
+            }
+            return row;
+        }
+
+        // Removes layer y, moves the layers above one down and leaves an empty top layer
+        void removeLayer(int y) {
+            releaseLayer(y);
+            // Moves directory handles only, not tiles
+            std::rotate(layers.begin() + y, layers.begin() + y + 1, layers.end());
+        }
+
+        // Drops the top layer, moves every layer one up and leaves an empty bottom layer
+        void insertBottomLayer() {
+            releaseLayer(height - 1);
+            std::rotate(layers.begin(), layers.end() - 1, layers.end());
+        }
+
+        // visit(x, y, z, colorIndex) for every occupied cell, layer by layer from the bottom
+        template <typename Visitor>
+        void forEachOccupied(Visitor&& visit) const {
+            for (int y = 0; y < height; ++y) {
+                const std::vector<int32_t>& directory = layers[y];
+                if (directory.empty()) continue;
+                for (int slot = 0; slot < static_cast<int>(directory.size()); ++slot) {
+                    if (directory[slot] == NO_TILE) continue;
+                    const Tile& tile = pool[directory[slot]];
+                    int baseX = (slot % tilesX) * TILE;
+                    int baseZ = (slot / tilesX) * TILE;
+                    for (uint64_t bits = tile.mask; bits; bits &= bits - 1) {
+                        int bit = __builtin_ctzll(bits);
+                        visit(baseX + (bit & (TILE - 1)), y, baseZ + bit / TILE, tile.colors[bit]);
+                    }
+                }
+            }
+        }
+
+        // Heap memory held by the board, tiles and directories included
+        size_t memoryBytes() const {
+            size_t bytes = pool.capacity() * sizeof(Tile) + freeTiles.capacity() * sizeof(int32_t)
+                         + (layers.capacity() + spareDirectories.capacity()) * sizeof(std::vector<int32_t>);
+            for (const std::vector<int32_t>& directory : layers) {
+                bytes += directory.capacity() * sizeof(int32_t);
+            }
+            for (const std::vector<int32_t>& directory : spareDirectories) {
+                bytes += directory.capacity() * sizeof(int32_t);
+            }
+            return bytes;
+        }
+};
+
+#endif
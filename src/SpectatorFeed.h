@@ -0,0 +1,231 @@
+#ifndef SPECTATORFEED_H
+#define SPECTATORFEED_H
+
+#include "Game.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Memory layout of the feed, shared by the game and every observer process:
+//   FeedHeader | slot 0 | slot 1 | ... | slot SLOT_COUNT-1
+// Each slot is a FeedSlot followed by the packed occupancy bits of the board
+// (layer-major: y, then z, then x), padded to a multiple of 8 bytes.
+namespace feed {
+
+const uint32_t MAGIC = 0x54334446; // "T3DF"
+const uint32_t VERSION = 1;
+const uint32_t SLOT_COUNT = 8;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the feed needs lock-free 64-bit atomics");
+
+struct FeedHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width, height, depth;
+    uint32_t slotCount;
+    uint32_t slotSize;   // Bytes per slot, header included
+    uint32_t reserved;
+    std::atomic<uint64_t> latest; // Number of published states, the newest is in slot (latest - 1) % slotCount
+};
+
+struct FeedSlot {
+    std::atomic<uint64_t> sequence; // Seqlock: odd while the writer is inside the slot
+    uint64_t tick;
+    int32_t score;
+    int32_t level;
+    int32_t linesCleared;
+    uint8_t running;
+    uint8_t pieceBlockCount;
+    int8_t pieceBlocks[4][3]; // Cells of the falling piece
+    uint8_t padding[2];
+};
+
+inline size_t boardBytes(uint32_t width, uint32_t height, uint32_t depth) {
+    size_t bits = static_cast<size_t>(width) * height * depth;
+    return ((bits + 63) / 64) * 8;
+}
+
+inline size_t slotSize(uint32_t width, uint32_t height, uint32_t depth) {
+    return sizeof(FeedSlot) + boardBytes(width, height, depth);
+}
+
+}
+
+// Publishes the game state after every tick into a POSIX shared-memory ring.
+// The writer never waits: readers detect torn slots through the seqlock and
+// simply retry or fall back to an older slot.
+class SpectatorFeedWriter {
+    private:
+        std::string name;
+        void* memory = MAP_FAILED;
+        size_t mappedSize = 0;
+        feed::FeedHeader* header = nullptr;
+        uint64_t published = 0;
+
+        unsigned char* slotAt(uint64_t index) const {
+            return reinterpret_cast<unsigned char*>(header + 1) + (index % header->slotCount) * header->slotSize;
+        }
+
+    public:
+        // name follows shm_open rules, e.g. "/tetris3d-feed"
+        SpectatorFeedWriter(const std::string& name, int width, int height, int depth): name(name) {
+            mappedSize = sizeof(feed::FeedHeader) + feed::SLOT_COUNT * feed::slotSize(width, height, depth);
+
+            int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+            if (fd < 0 || ftruncate(fd, mappedSize) != 0) {
+                std::cerr << "[Error] Could not create the spectator feed " << name << std::endl;
+                if (fd >= 0) close(fd);
+                return;
+            }
+            memory = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (memory == MAP_FAILED) {
+                std::cerr << "[Error] Could not map the spectator feed " << name << std::endl;
+                return;
+            }
+
+            std::memset(memory, 0, mappedSize);
+            header = static_cast<feed::FeedHeader*>(memory);
+            header->width = width;
+            header->height = height;
+            header->depth = depth;
+            header->slotCount = feed::SLOT_COUNT;
+            header->slotSize = static_cast<uint32_t>(feed::slotSize(width, height, depth));
+            header->version = feed::VERSION;
+            header->latest.store(0, std::memory_order_relaxed);
+            // Readers only trust the layout once the magic is visible
+            std::atomic_thread_fence(std::memory_order_release);
+            header->magic = feed::MAGIC;
+        }
+
+        bool isOpen() const {
+            return header != nullptr;
+        }
+
+        void publish(const Game& game, uint64_t tick) {
+            if (!header) return;
+
+            unsigned char* slotBytes = slotAt(published);
+            feed::FeedSlot* slot = reinterpret_cast<feed::FeedSlot*>(slotBytes);
+            uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+            slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            slot->tick = tick;
+            slot->score = game.getScore();
+            slot->level = game.getLevel();
+            slot->linesCleared = game.getTotalLinesCleared();
+            slot->running = game.getIsRunning() ? 1 : 0;
+
+            const std::vector<Block>& blocks = game.getCurrentTetromino().getBlocks();
+            slot->pieceBlockCount = static_cast<uint8_t>(std::min<size_t>(blocks.size(), 4));
+            for (int i = 0; i < slot->pieceBlockCount; ++i) {
+                glm::vec3 pos = blocks[i].getPosition();
+                slot->pieceBlocks[i][0] = static_cast<int8_t>(pos.x);
+                slot->pieceBlocks[i][1] = static_cast<int8_t>(pos.y);
+                slot->pieceBlocks[i][2] = static_cast<int8_t>(pos.z);
+            }
+
+            const Grid& grid = game.getGrid();
+            unsigned char* board = slotBytes + sizeof(feed::FeedSlot);
+            std::memset(board, 0, feed::boardBytes(header->width, header->height, header->depth));
+            grid.forEachOccupiedCell([&](int x, int y, int z, uint8_t) {
+                size_t bit = (static_cast<size_t>(y) * header->depth + z) * header->width + x;
+                board[bit >> 3] |= static_cast<unsigned char>(1u << (bit & 7));
+            });
+
+            std::atomic_thread_fence(std::memory_order_release);
+            slot->sequence.store(sequence + 2, std::memory_order_release);
+            published++;
+            header->latest.store(published, std::memory_order_release);
+        }
+
+        ~SpectatorFeedWriter() {
+            if (memory != MAP_FAILED) {
+                munmap(memory, mappedSize);
+                shm_unlink(name.c_str());
+            }
+        }
+};
+
+// Read side, for viewer, recorder or analytics processes. Reads happen in
+// place in the mapping: no copies and no system calls per frame.
+class SpectatorFeedReader {
+    private:
+        void* memory = MAP_FAILED;
+        size_t mappedSize = 0;
+        const feed::FeedHeader* header = nullptr;
+
+    public:
+        SpectatorFeedReader(const std::string& name) {
+            int fd = shm_open(name.c_str(), O_RDONLY, 0);
+            if (fd < 0) return;
+
+            struct stat info;
+            if (fstat(fd, &info) == 0 && info.st_size >= (off_t)sizeof(feed::FeedHeader)) {
+                mappedSize = info.st_size;
+                memory = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+            }
+            close(fd);
+            if (memory == MAP_FAILED) return;
+
+            const feed::FeedHeader* candidate = static_cast<const feed::FeedHeader*>(memory);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (candidate->magic == feed::MAGIC && candidate->version == feed::VERSION) {
+                header = candidate;
+            }
+        }
+
+        bool isOpen() const {
+            return header != nullptr;
+        }
+
+        const feed::FeedHeader* getHeader() const {
+            return header;
+        }
+
+        // Calls visit(slot, board) on the newest state. visit may observe a slot being
+        // overwritten: its results only count when this returns true. Returns false if
+        // nothing was published yet or the writer kept overwriting the slot.
+        template <typename Visitor>
+        bool readLatest(Visitor visit, int maxAttempts = 4) const {
+            if (!header) return false;
+
+            for (int attempt = 0; attempt < maxAttempts; ++attempt) {
+                uint64_t latest = header->latest.load(std::memory_order_acquire);
+                if (latest == 0) return false;
+
+                const unsigned char* slotBytes = reinterpret_cast<const unsigned char*>(header + 1) + ((latest - 1) % header->slotCount) * header->slotSize;
+                const feed::FeedSlot* slot = reinterpret_cast<const feed::FeedSlot*>(slotBytes);
+
+                uint64_t before = slot->sequence.load(std::memory_order_acquire);
+                if (before & 1) continue;
+                visit(*slot, slotBytes + sizeof(feed::FeedSlot));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot->sequence.load(std::memory_order_relaxed) == before) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Occupancy of a cell in the packed board of a slot
+        bool isCellOccupied(const unsigned char* board, int x, int y, int z) const {
+            size_t bit = (static_cast<size_t>(y) * header->depth + z) * header->width + x;
+            return (board[bit >> 3] >> (bit & 7)) & 1;
+        }
+
+        ~SpectatorFeedReader() {
+            if (memory != MAP_FAILED) {
+                munmap(memory, mappedSize);
+            }
+        }
+};
+
+#endif
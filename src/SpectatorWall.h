@@ -0,0 +1,303 @@
+#ifndef SPECTATORWALL_H
+#define SPECTATORWALL_H
+
+#include "Game.h"
+#include "Shader.h"
+#include "UIRenderer.h"
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Renders many games side by side in a grid of tiles, e.g. for tournaments or
+// bot batch runs. Every block of every board goes into one shared instance
+// buffer tagged with its board index, and the vertex shader moves each board
+// into its tile. Blocks, ghosts, grid lines and HUDs take a constant number of
+// draw calls whatever the number of boards.
+class SpectatorWall : public Shader {
+    private:
+        static const int FLOATS_PER_INSTANCE = 6; // vec4 cell + board index, vec2 palette index + alpha
+
+        static constexpr const char* WALL_VERTEX_SHADER = R"(
+        #version 330 core
+        layout (location = 0) in vec3 aPos;
+        layout (location = 1) in vec4 aCell;  // xyz: cell, w: board index
+        layout (location = 2) in vec2 aColor; // x: palette index, y: alpha
+
+        uniform mat4 projection;
+        uniform mat4 view;
+        uniform vec2 tiles; // Columns and rows of the wall
+        uniform vec3 palette[16];
+
+        out vec4 Color;
+        out float FragHeight;
+
+        void main() {
+            vec4 clip = projection * view * vec4(aPos + aCell.xyz, 1.0);
+
+            // Squeeze the board into its tile, in clip space so perspective is preserved
+            float column = mod(aCell.w, tiles.x);
+            float row = floor(aCell.w / tiles.x);
+            vec2 tileCenter = vec2(-1.0 + (2.0 * column + 1.0) / tiles.x, 1.0 - (2.0 * row + 1.0) / tiles.y);
+            clip.xy = clip.xy / tiles + tileCenter * clip.w;
+
+            gl_Position = clip;
+            Color = vec4(palette[int(aColor.x)], aColor.y);
+            FragHeight = aPos.y + aCell.y;
+        }
+        )";
+
+        static constexpr const char* WALL_FRAGMENT_SHADER = R"(
+        #version 330 core
+        in vec4 Color;
+        in float FragHeight;
+        out vec4 FragColor;
+
+        uniform bool fadeWithHeight; // Grid lines fade out towards the top like in the single board view
+
+        void main() {
+            float alpha = Color.a;
+            if (fadeWithHeight) {
+                alpha *= 1.0 - clamp(abs(FragHeight) / 18.0, 0.0, 1.0);
+            }
+            FragColor = vec4(Color.rgb, alpha);
+        }
+        )";
+
+        UIRenderer& ui;
+        int width, height, depth;
+        int columns = 1, rows = 1;
+
+        GLuint cubeVAO = 0, cubeVBO = 0, cubeEBO = 0, ghostVAO = 0;
+        GLuint gridVAO = 0, gridVBO = 0;
+        GLuint blockInstanceVBO = 0, gridInstanceVBO = 0;
+        int gridVertexCount = 0;
+        size_t blockInstanceCapacity = 0;
+        int gridInstanceBoards = 0;
+
+        std::vector<float> instances; // Solid blocks of every board first, then every ghost
+        UIBatch hudBatch;
+        std::vector<GameEventReader> hudReaders;
+
+        glm::mat4 projection, view;
+
+        // Attributes 1 and 2 read the instance buffer starting at the given instance
+        void setInstanceAttributes(GLuint buffer, size_t firstInstance) {
+            GLsizei stride = FLOATS_PER_INSTANCE * sizeof(float);
+            size_t base = firstInstance * stride;
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (void*)base);
+            glEnableVertexAttribArray(1);
+            glVertexAttribDivisor(1, 1);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(base + 4 * sizeof(float)));
+            glEnableVertexAttribArray(2);
+            glVertexAttribDivisor(2, 1);
+        }
+
+        void initializeBuffers() {
+            float vertices[] = {
+                0.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  1.0f, 1.0f, 0.0f,  0.0f, 1.0f, 0.0f,
+                0.0f, 0.0f, 1.0f,  1.0f, 0.0f, 1.0f,  1.0f, 1.0f, 1.0f,  0.0f, 1.0f, 1.0f
+            };
+            unsigned int indices[] = {
+                0, 1, 2, 2, 3, 0,  4, 5, 6, 6, 7, 4,  0, 3, 7, 7, 4, 0,
+                1, 2, 6, 6, 5, 1,  0, 1, 5, 5, 4, 0,  3, 2, 6, 6, 7, 3
+            };
+
+            glGenBuffers(1, &cubeVBO);
+            glGenBuffers(1, &cubeEBO);
+            glGenBuffers(1, &blockInstanceVBO);
+            glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+            // Solid blocks and ghosts share the cube and the instance buffer, only the instance offset differs
+            for (GLuint* vao : { &cubeVAO, &ghostVAO }) {
+                glGenVertexArrays(1, vao);
+                glBindVertexArray(*vao);
+                glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+                glEnableVertexAttribArray(0);
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeEBO);
+                if (vao == &cubeVAO) {
+                    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+                }
+                setInstanceAttributes(blockInstanceVBO, 0);
+            }
+
+            // Grid lines of one board, instanced once per board
+            std::vector<float> lines;
+            for (int y = 0; y <= height; ++y) {
+                lines.insert(lines.end(), { 0, (float)y, 0, (float)width, (float)y, 0 });
+                lines.insert(lines.end(), { 0, (float)y, 0, 0, (float)y, (float)depth });
+            }
+            for (int z = 0; z <= depth; ++z) {
+                lines.insert(lines.end(), { 0, 0, (float)z, 0, (float)height, (float)z });
+                lines.insert(lines.end(), { 0, 0, (float)z, (float)width, 0, (float)z });
+            }
+            for (int x = 0; x <= width; ++x) {
+                lines.insert(lines.end(), { (float)x, 0, 0, (float)x, (float)height, 0 });
+                lines.insert(lines.end(), { (float)x, 0, 0, (float)x, 0, (float)depth });
+            }
+            gridVertexCount = static_cast<int>(lines.size() / 3);
+
+            glGenVertexArrays(1, &gridVAO);
+            glGenBuffers(1, &gridVBO);
+            glGenBuffers(1, &gridInstanceVBO);
+            glBindVertexArray(gridVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
+            glBufferData(GL_ARRAY_BUFFER, lines.size() * sizeof(float), lines.data(), GL_STATIC_DRAW);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
+            setInstanceAttributes(gridInstanceVBO, 0);
+
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+        }
+
+        void appendInstance(float x, float y, float z, int board, uint8_t colorIndex, float alpha) {
+            instances.insert(instances.end(), { x, y, z, (float)board, (float)colorIndex, alpha });
+        }
+
+        void appendTetromino(const Tetromino& tetromino, int board, float alpha) {
+            for (const Block& block : tetromino.getBlocks()) {
+                glm::vec3 pos = block.getPosition();
+                appendInstance(pos.x, pos.y, pos.z, board, block.getColorIndex(), alpha);
+            }
+        }
+
+        void updateLayout(int boardCount) {
+            columns = static_cast<int>(std::ceil(std::sqrt((double)boardCount)));
+            rows = (boardCount + columns - 1) / columns;
+
+            // The camera of the single board view, with the aspect ratio of one tile
+            float tileAspect = (1600.0f / columns) / (1200.0f / rows);
+            projection = glm::perspective(glm::radians(45.0f), tileAspect, 0.1f, 100.0f);
+            view = glm::lookAt(glm::vec3(15, 25, 15), glm::vec3(5, 10, 5), glm::vec3(0, 1, 0));
+
+            // One grid instance per board, only rebuilt when the number of boards changes
+            std::vector<float> gridInstances;
+            for (int board = 0; board < boardCount; ++board) {
+                gridInstances.insert(gridInstances.end(), { 0, 0, 0, (float)board, (float)palette::EMPTY, 1.0f });
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, gridInstanceVBO);
+            glBufferData(GL_ARRAY_BUFFER, gridInstances.size() * sizeof(float), gridInstances.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            gridInstanceBoards = boardCount;
+            hudReaders.assign(boardCount, GameEventReader());
+            hudBatch.clear();
+        }
+
+        // The HUD of all boards is one UI batch, rebuilt only when a score or level changed
+        void updateHud(const std::vector<std::unique_ptr<Game>>& games) {
+            bool dirty = hudBatch.vertexCount() == 0;
+            GameEvent event;
+            for (size_t board = 0; board < games.size(); ++board) {
+                while (hudReaders[board].poll(games[board]->getEvents(), event)) {
+                    if (event.type == GameEventType::GameStarted || event.type == GameEventType::LayersCleared || event.type == GameEventType::LevelUp) {
+                        dirty = true;
+                    }
+                }
+                dirty = hudReaders[board].checkOverflow() || dirty;
+            }
+            if (!dirty) return;
+
+            hudBatch.clear();
+            float tileWidth = 1600.0f / columns;
+            float tileHeight = 1200.0f / rows;
+            float scale = std::min(0.6f, 2.4f / columns);
+            for (size_t board = 0; board < games.size(); ++board) {
+                float x = (board % columns) * tileWidth + 8.0f;
+                float y = 1200.0f - (board / columns) * tileHeight - 48.0f * scale - 4.0f;
+                char text[64];
+                std::snprintf(text, sizeof(text), "#%d Score %d Lv %d", static_cast<int>(board) + 1, games[board]->getScore(), games[board]->getLevel());
+                ui.addText(hudBatch, text, x, y, scale, glm::vec3(1.0f, 1.0f, 1.0f));
+            }
+            hudBatch.upload();
+        }
+
+    public:
+        // All boards must share the given dimensions
+        SpectatorWall(UIRenderer& ui, int width, int height, int depth)
+            : Shader(WALL_VERTEX_SHADER, WALL_FRAGMENT_SHADER), ui(ui), width(width), height(height), depth(depth) {
+            initializeBuffers();
+            use();
+            setPalette();
+        }
+
+        void render(const std::vector<std::unique_ptr<Game>>& games) {
+            int boardCount = static_cast<int>(games.size());
+            if (boardCount == 0) return;
+            if (boardCount != gridInstanceBoards) {
+                updateLayout(boardCount);
+            }
+
+            // Pack every board: locked cells and falling pieces, then ghosts at the end
+            instances.clear();
+            for (int board = 0; board < boardCount; ++board) {
+                const Game& game = *games[board];
+                const Grid& grid = game.getGrid();
+                grid.forEachOccupiedCell([&](int x, int y, int z, uint8_t colorIndex) {
+                    appendInstance(x, y, z, board, colorIndex, 1.0f);
+                });
+                appendTetromino(game.getCurrentTetromino(), board, 1.0f);
+            }
+            size_t solidCount = instances.size() / FLOATS_PER_INSTANCE;
+            for (int board = 0; board < boardCount; ++board) {
+                const Game& game = *games[board];
+                appendTetromino(game.getProjectedTetromino(), board, 0.35f);
+            }
+            size_t ghostCount = instances.size() / FLOATS_PER_INSTANCE - solidCount;
+
+            glBindBuffer(GL_ARRAY_BUFFER, blockInstanceVBO);
+            if (instances.size() > blockInstanceCapacity) {
+                blockInstanceCapacity = instances.capacity();
+                glBufferData(GL_ARRAY_BUFFER, blockInstanceCapacity * sizeof(float), nullptr, GL_STREAM_DRAW);
+            }
+            glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(float), instances.data());
+
+            use();
+            setUniformMatrix4fv("projection", projection);
+            setUniformMatrix4fv("view", view);
+            glUniform2f(glGetUniformLocation(ID, "tiles"), (float)columns, (float)rows);
+
+            // 1: grid lines of every board
+            setUniform1i("fadeWithHeight", true);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glBindVertexArray(gridVAO);
+            glDrawArraysInstanced(GL_LINES, 0, gridVertexCount, boardCount);
+
+            // 2: every solid block
+            setUniform1i("fadeWithHeight", false);
+            glBindVertexArray(cubeVAO);
+            glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0, (GLsizei)solidCount);
+
+            // 3: every ghost, translucent, reading the tail of the same instance buffer
+            glBindVertexArray(ghostVAO);
+            setInstanceAttributes(blockInstanceVBO, solidCount);
+            glDepthMask(GL_FALSE);
+            glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0, (GLsizei)ghostCount);
+            glDepthMask(GL_TRUE);
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            // 4: the HUD of every board
+            updateHud(games);
+            ui.draw(hudBatch);
+        }
+
+        ~SpectatorWall() {
+            glDeleteVertexArrays(1, &cubeVAO);
+            glDeleteVertexArrays(1, &ghostVAO);
+            glDeleteVertexArrays(1, &gridVAO);
+            glDeleteBuffers(1, &cubeVBO);
+            glDeleteBuffers(1, &cubeEBO);
+            glDeleteBuffers(1, &gridVBO);
+            glDeleteBuffers(1, &blockInstanceVBO);
+            glDeleteBuffers(1, &gridInstanceVBO);
+        }
+};
+
+#endif
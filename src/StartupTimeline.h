@@ -0,0 +1,69 @@
+#ifndef STARTUPTIMELINE_H
+#define STARTUPTIMELINE_H
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Milliseconds spent in each initialisation phase, printed once the first frame
+// is on screen. Phases marked later, e.g. a screen created the first time it is
+// shown, are printed right away.
+class StartupTimeline {
+    private:
+        struct Phase {
+            std::string name;
+            double milliseconds;
+        };
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point last = start;
+        std::vector<Phase> phases;
+        bool reported = false;
+
+        static double millisecondsBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+            return std::chrono::duration<double, std::milli>(to - from).count();
+        }
+
+    public:
+        // Closes the phase that started at the previous mark
+        void mark(const std::string& name) {
+            auto now = std::chrono::steady_clock::now();
+            double milliseconds = millisecondsBetween(last, now);
+            last = now;
+            if (reported) {
+                char line[160];
+                std::snprintf(line, sizeof(line), "[Startup] %s: %.1f ms (lazy)", name.c_str(), milliseconds);
+                std::cerr << line << std::endl;
+            } else {
+                phases.push_back({ name, milliseconds });
+            }
+        }
+
+        // Starts a phase without recording the time since the previous mark, e.g. idle frames before a lazy init
+        void restart() {
+            last = std::chrono::steady_clock::now();
+        }
+
+        bool isReported() const {
+            return reported;
+        }
+
+        // Called once the first frame was presented
+        void reportFirstFrame(const std::string& details = "") {
+            if (reported) return;
+            mark("first frame");
+            reported = true;
+
+            char line[160];
+            for (const Phase& phase : phases) {
+                std::snprintf(line, sizeof(line), "[Startup] %-24s %8.1f ms", phase.name.c_str(), phase.milliseconds);
+                std::cerr << line << std::endl;
+            }
+            std::snprintf(line, sizeof(line), "[Startup] Time to first frame: %.1f ms", millisecondsBetween(start, last));
+            std::cerr << line << (details.empty() ? "" : ", " + details) << std::endl;
+        }
+};
+
+#endif
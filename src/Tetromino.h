@@ -8,8 +8,8 @@ private:
     // A collection of blocks that make up the Tetromino
     std::vector<Block> blocks;
 
-    // Color of the Tetromino, applied to all its blocks
-    glm::vec3 color;
+    // Palette index of the Tetromino, applied to all its blocks
+    uint8_t colorIndex;
 
     glm::vec3 center;
 
@@ -17,17 +17,6 @@ private:
     glm::mat4 rotation;
 
 
-    // Maximum value for random color generation (normalized to 1.0f)
-    const int rand_max = 255;
-
-    // Generates a random color for the Tetromino
-    glm::vec3 randomColor() {
-        float r = static_cast<float>(rand()) / RAND_MAX; // Generate red component
-        float g = static_cast<float>(rand()) / RAND_MAX; // Generate green component
-        float b = static_cast<float>(rand()) / RAND_MAX; // Generate blue component
-        return glm::vec3(r, g, b);
-    }
-
     void calculateCenter() {
         if (blocks.empty()) return;
         glm::vec3 sum(0, 0, 0);
@@ -45,46 +34,46 @@ private:
         void setShape(int shape) {
         switch (shape) {
         case 0: // I-shape
-            addBlock(Block(glm::vec3(0, 0, 0), color));
-            addBlock(Block(glm::vec3(1, 0, 0), color));
-            addBlock(Block(glm::vec3(2, 0, 0), color));
-            addBlock(Block(glm::vec3(3, 0, 0), color));
+            addBlock(Block(glm::vec3(0, 0, 0), colorIndex));
+            addBlock(Block(glm::vec3(1, 0, 0), colorIndex));
+            addBlock(Block(glm::vec3(2, 0, 0), colorIndex));
+            addBlock(Block(glm::vec3(3, 0, 0), colorIndex));
             break;
         case 1: // J-shape
-            addBlock(Block(glm::vec3(0, 0, 0), color));
-            addBlock(Block(glm::vec3(1, 0, 0), color));
-            addBlock(Block(glm::vec3(1, 1, 0), color));
-            addBlock(Block(glm::vec3(1, 2, 0), color));
+            addBlock(Block(glm::vec3(0, 0, 0), colorIndex));
+            addBlock(Block(glm::vec3(1, 0, 0), colorIndex));
+            addBlock(Block(glm::vec3(1, 1, 0), colorIndex));
+            addBlock(Block(glm::vec3(1, 2, 0), colorIndex));
             break;
         case 2: // L-shape
-            addBlock(Block(glm::vec3(0, 0, 0), color));
-            addBlock(Block(glm::vec3(1, 0, 0), color));
-            addBlock(Block(glm::vec3(0, 1, 0), color));
-            addBlock(Block(glm::vec3(0, 2, 0), color));
+            addBlock(Block(glm::vec3(0, 0, 0), colorIndex));
+            addBlock(Block(glm::vec3(1, 0, 0), colorIndex));
+            addBlock(Block(glm::vec3(0, 1, 0), colorIndex));
+            addBlock(Block(glm::vec3(0, 2, 0), colorIndex));
             break;
         case 3: // O-shape
-            addBlock(Block(glm::vec3(0, 0, 0), color));
-            addBlock(Block(glm::vec3(1, 0, 0), color));
-            addBlock(Block(glm::vec3(0, 1, 0), color));
-            addBlock(Block(glm::vec3(1, 1, 0), color));
+            addBlock(Block(glm::vec3(0, 0, 0), colorIndex));
+            addBlock(Block(glm::vec3(1, 0, 0), colorIndex));
+            addBlock(Block(glm::vec3(0, 1, 0), colorIndex));
+            addBlock(Block(glm::vec3(1, 1, 0), colorIndex));
             break;
         case 4: // S-shape
-            addBlock(Block(glm::vec3(0, 0, 0), color));
-            addBlock(Block(glm::vec3(0, 1, 0), color));
-            addBlock(Block(glm::vec3(1, 1, 0), color));
-            addBlock(Block(glm::vec3(2, 1, 0), color));
+            addBlock(Block(glm::vec3(0, 0, 0), colorIndex));
+            addBlock(Block(glm::vec3(0, 1, 0), colorIndex));
+            addBlock(Block(glm::vec3(1, 1, 0), colorIndex));
+            addBlock(Block(glm::vec3(2, 1, 0), colorIndex));
             break;
         case 5: // T-shape
-            addBlock(Block(glm::vec3(0, 0, 0), color));
-            addBlock(Block(glm::vec3(1, 0, 0), color));
-            addBlock(Block(glm::vec3(2, 0, 0), color));
-            addBlock(Block(glm::vec3(1, 1, 0), color));
+            addBlock(Block(glm::vec3(0, 0, 0), colorIndex));
+            addBlock(Block(glm::vec3(1, 0, 0), colorIndex));
+            addBlock(Block(glm::vec3(2, 0, 0), colorIndex));
+            addBlock(Block(glm::vec3(1, 1, 0), colorIndex));
             break;
         case 6: // Z-shape
-            addBlock(Block(glm::vec3(0, 1, 0), color));
-            addBlock(Block(glm::vec3(1, 1, 0), color));
-            addBlock(Block(glm::vec3(1, 0, 0), color));
-            addBlock(Block(glm::vec3(2, 0, 0), color));
+            addBlock(Block(glm::vec3(0, 1, 0), colorIndex));
+            addBlock(Block(glm::vec3(1, 1, 0), colorIndex));
+            addBlock(Block(glm::vec3(1, 0, 0), colorIndex));
+            addBlock(Block(glm::vec3(2, 0, 0), colorIndex));
             break;
         default:
             break;
@@ -99,13 +88,20 @@ private:
 public:
     Tetromino() {}
     // Constructor: Initializes the Tetromino at a position with a specific shape
-    Tetromino(const glm::vec3& pos, int shape) : color(randomColor()) , rotation(glm::mat4(1.0f)) {
-        setShape(shape);
-        calculateCenter();
-        move(glm::vec3 (pos.x, pos.y, pos.z)); // Adjust blocks to the initial position
+    Tetromino(const glm::vec3& pos, int shape) {
+        reset(pos, shape, palette::randomIndex());
+    }
+
+    Tetromino(const glm::vec3& pos, int shape, uint8_t colorIndex) {
+        reset(pos, shape, colorIndex);
     }
 
-    Tetromino(const glm::vec3& pos, int shape, const glm::vec3& col) : color(col) , rotation(glm::mat4(1.0f)) {
+    // Turns this Tetromino into a new one, reusing the block storage so that spawning does not allocate
+    void reset(const glm::vec3& pos, int shape, uint8_t newColorIndex) {
+        blocks.clear();
+        blocks.reserve(4);
+        colorIndex = newColorIndex;
+        rotation = glm::mat4(1.0f);
         setShape(shape);
         calculateCenter();
         move(glm::vec3 (pos.x, pos.y, pos.z)); // Adjust blocks to the initial position
@@ -115,7 +111,7 @@ public:
     Tetromino& operator=(const Tetromino& other) {
         if (this != &other) {
             blocks = other.blocks;
-            color = other.color;
+            colorIndex = other.colorIndex;
             rotation = other.rotation;
         }
         return *this;
@@ -128,8 +124,8 @@ public:
         }
     }
 
-    glm::vec3 getColor(){
-        return color;
+    uint8_t getColorIndex() const {
+        return colorIndex;
     }
 
     // Rotates the Tetromino around a specified axis by a given angle
@@ -152,12 +148,6 @@ public:
         }
     }
 
-    // Draws the Tetromino by drawing each block
-    void draw(const Shader& shader) const {
-        for (const Block& block : blocks) {
-            block.draw(shader);
-        }
-    }
     // Returns a constant reference to the blocks in the Tetromino
     const std::vector<Block>& getBlocks() const { return blocks; }
 };
@@ -2,32 +2,35 @@
 #define TEXTSHADER_H
 
 #include "Shader.h"
+#include "UIRenderer.h"
+#include "RenderQueue.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include <glm/glm.hpp>
-#include <ft2build.h>
-#include FT_FREETYPE_H
-#include <map>
 #include <string>
+#include <vector>
 #include <iostream>
 
+// Text is laid out from the glyph atlas of UIRenderer: the quads of every string of a frame
+// go into one vertex buffer uploaded once and drawn by a single RenderQueue command, with
+// the atlas as the only texture.
 class TextShader : public Shader {
 private:
-    GLuint VAO, VBO;
+    static const int FLOATS_PER_VERTEX = 7; // vec2 position, vec2 tex coords, vec3 color
 
-    // Struct to store character data
-    struct Character {
-        GLuint TextureID;   // Texture ID for the glyph
-        glm::ivec2 Size;    // Size of the glyph
-        glm::ivec2 Bearing; // Offset from the baseline
-        GLuint Advance;     // Advance to the next character
-    };
-
-    std::map<char, Character> Characters;
+    const UIRenderer& atlas;
+    GLuint VAO = 0, VBO = 0;
+    size_t uploadedCapacity = 0; // Floats the VBO can hold
+    std::vector<float> vertices; // Glyphs queued since the last clear()
+    uint64_t textState = 0;      // RenderQueue state of the text, see attach()
 
     // Vertex Shader source
-    const char* vertexShaderSource = R"(
+    static constexpr const char* TEXT_VERTEX_SHADER = R"(
     #version 330 core
     layout (location = 0) in vec4 vertex; // <vec2 pos, vec2 tex>
+    layout (location = 1) in vec3 vertexColor;
     out vec2 TexCoords;
+    out vec3 TextColor;
 
     uniform mat4 projection;
 
@@ -35,104 +38,48 @@ private:
     {
         gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
         TexCoords = vertex.zw;
+        TextColor = vertexColor;
     }
     )";
 
     // Fragment Shader source
-    const char* fragmentShaderSource = R"(
+    static constexpr const char* TEXT_FRAGMENT_SHADER = R"(
     #version 330 core
     in vec2 TexCoords;
+    in vec3 TextColor;
     out vec4 color;
 
     uniform sampler2D text;
-    uniform vec3 textColor;
 
     void main()
     {
         vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);
-        color = vec4(textColor, 1.0) * sampled;
+        color = vec4(TextColor, 1.0) * sampled;
     }
     )";
 
-    void initializeFont(const char* fontPath) {
-        FT_Library ft;
-        if (FT_Init_FreeType(&ft)) {
-            std::cerr << "[Error] Could not initialize FreeType Library!" << std::endl;
-            return;
-        }
-
-        FT_Face face;
-        if (FT_New_Face(ft, fontPath, 0, &face)) {
-            std::cerr << "[Error] Failed to load font: " << fontPath << std::endl;
-            return;
-        }
-
-        FT_Set_Pixel_Sizes(face, 0, 48);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-        for (unsigned char c = 0; c < 128; c++) {
-            if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
-                std::cerr << "[Error] Failed to load character: " << c << std::endl;
-                continue;
-            }
-
-            if(Characters.find(c) != Characters.end()){
-                continue;
-            }
-
-            GLuint texture;
-            glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            glTexImage2D(
-                GL_TEXTURE_2D,
-                0,
-                GL_RED,
-                face->glyph->bitmap.width,
-                face->glyph->bitmap.rows,
-                0,
-                GL_RED,
-                GL_UNSIGNED_BYTE,
-                face->glyph->bitmap.buffer
-            );
-
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-            Character character = {
-                texture,
-                glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-                glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-                static_cast<GLuint>(face->glyph->advance.x)
-            };
-            Characters.insert(std::pair<char, Character>(c, character));
-        }
-
-        FT_Done_Face(face);
-        FT_Done_FreeType(ft);
-
+    void initializeBuffers() {
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
         glBindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
+        GLsizei stride = FLOATS_PER_VERTEX * sizeof(float);
         glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, 0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(4 * sizeof(float)));
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
     }
 
 public:
-    TextShader() {
-        ID = createShaderProgram(vertexShaderSource, fragmentShaderSource);
-        initializeFont("./utils/Super_cartoon.ttf");
+    // Builds only the text program, not the block program of the default Shader constructor.
+    // atlas must outlive the TextShader.
+    explicit TextShader(const UIRenderer& atlas): Shader(TEXT_VERTEX_SHADER, TEXT_FRAGMENT_SHADER), atlas(atlas) {
+        initializeBuffers();
     }
 
     void cleanup() {
-        for (auto& c : Characters) {
-            glDeleteTextures(1, &c.second.TextureID);
-        }
         glDeleteVertexArrays(1, &VAO);
         glDeleteBuffers(1, &VBO);
         glDeleteProgram(ID);
@@ -142,58 +89,79 @@ public:
         glUseProgram(ID);
     }
 
-    void setVec3(const std::string& name, const glm::vec3& value) const {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    void setVec3(const char* name, const glm::vec3& value) const {
+        glUniform3fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
 
-    void setMat4(const std::string& name, const glm::mat4& mat) const {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    void setMat4(const char* name, const glm::mat4& mat) const {
+        glUniformMatrix4fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
 
-    void renderText(const std::string& text, float x, float y, float scale, glm::vec3 color) {
-        use();
-        setVec3("textColor", color);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glActiveTexture(GL_TEXTURE0);
-        glBindVertexArray(VAO);
+    // Registers the program, the vertex array and the atlas with the queue the text goes through
+    void attach(RenderQueue& queue) {
+        int program = queue.addProgram(ID, false);
+        textState = RenderQueue::stateKey(true, program, queue.addVertexArray(VAO), queue.addTexture(atlas.getAtlasTexture()));
+    }
 
-        for (char c : text) {
-            if (Characters.find(c) == Characters.end()) {
-                std::cerr << "[Warning] Character '" << c << "' not found! Skipping..." << std::endl;
+    // Appends the glyphs of text; they are drawn by the command of submit()
+    void queueText(const char* text, float x, float y, float scale, glm::vec3 color) {
+        TRACE_SCOPE("TextShader::queueText");
+        for (; *text; ++text) {
+            unsigned char c = static_cast<unsigned char>(*text);
+            if (c < 32 || c >= 128) {
+                std::cerr << "[Warning] Character '" << *text << "' not found! Skipping..." << std::endl;
                 continue;
             }
 
-            Character ch = Characters[c];
+            const AtlasGlyph& glyph = atlas.getGlyph(c);
 
-            float xpos = x + ch.Bearing.x * scale;
-            float ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
+            float xpos = x + glyph.Bearing.x * scale;
+            float ypos = y - (glyph.Size.y - glyph.Bearing.y) * scale;
 
-            float w = ch.Size.x * scale;
-            float h = ch.Size.y * scale;
+            float w = glyph.Size.x * scale;
+            float h = glyph.Size.y * scale;
+            glm::vec2 uv0 = glyph.uvMin, uv1 = glyph.uvMax;
 
-            float vertices[6][4] = {
-                { xpos,     ypos + h,   0.0f, 0.0f },
-                { xpos,     ypos,       0.0f, 1.0f },
-                { xpos + w, ypos,       1.0f, 1.0f },
+            float quad[6][4] = {
+                { xpos,     ypos + h,   uv0.x, uv0.y },
+                { xpos,     ypos,       uv0.x, uv1.y },
+                { xpos + w, ypos,       uv1.x, uv1.y },
 
-                { xpos,     ypos + h,   0.0f, 0.0f },
-                { xpos + w, ypos,       1.0f, 1.0f },
-                { xpos + w, ypos + h,   1.0f, 0.0f }
+                { xpos,     ypos + h,   uv0.x, uv0.y },
+                { xpos + w, ypos,       uv1.x, uv1.y },
+                { xpos + w, ypos + h,   uv1.x, uv0.y }
             };
 
-            glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
-            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            for (const float* vertex : quad) {
+                vertices.insert(vertices.end(), { vertex[0], vertex[1], vertex[2], vertex[3], color.x, color.y, color.z });
+            }
+            metrics::increment(metrics::Counter::GlyphsDrawn);
 
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+            x += glyph.Advance * scale;
+        }
+    }
 
-            x += (ch.Advance >> 6) * scale; // Bitshift by 6 to convert from 1/64th pixels to pixels
+    // Sends the vertices of every queued glyph in one upload and queues their single draw,
+    // before the queue is flushed
+    void submit(RenderQueue& queue) {
+        if (vertices.empty()) return;
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        if (vertices.size() > uploadedCapacity) {
+            uploadedCapacity = vertices.capacity();
+            glBufferData(GL_ARRAY_BUFFER, uploadedCapacity * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
         }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(float), vertices.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-        glBindVertexArray(0);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        RenderCommand command;
+        command.key = textState;
+        command.count = static_cast<GLsizei>(vertices.size() / FLOATS_PER_VERTEX);
+        queue.submit(command);
+    }
+
+    // Once the queue has drawn them
+    void clear() {
+        vertices.clear();
     }
     
     ~TextShader(){
@@ -0,0 +1,138 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Scoped CPU spans exported as Chrome trace-event JSON (chrome://tracing, Perfetto).
+// Compiled out completely unless built with -DTETRIS_TRACE:
+//   TRACE_SCOPE("name")   records the enclosing scope, name must be a string literal
+//   TRACE_WRITE(path)     writes every recorded span to path
+
+#ifdef TETRIS_TRACE
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace trace {
+
+struct SpanEvent {
+    const char* name;
+    uint64_t startNanoseconds;
+    uint64_t durationNanoseconds;
+};
+
+// Flight recorder of one thread: the writer overwrites the oldest spans and
+// publishes its position with a release store, so recording never blocks.
+struct ThreadBuffer {
+    static const uint64_t CAPACITY = 1 << 16; // Must be a power of two
+
+    std::array<SpanEvent, CAPACITY> events;
+    std::atomic<uint64_t> written{0};
+    int threadId = 0;
+
+    void record(const SpanEvent& event) {
+        uint64_t index = written.load(std::memory_order_relaxed);
+        events[index & (CAPACITY - 1)] = event;
+        written.store(index + 1, std::memory_order_release);
+    }
+};
+
+const int MAX_THREADS = 32;
+
+struct Registry {
+    std::array<std::atomic<ThreadBuffer*>, MAX_THREADS> buffers{};
+    std::atomic<int> threadCount{0};
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+inline Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+// Buffers are allocated once per thread and intentionally never freed, so a
+// flush can still read them after the thread exited
+inline ThreadBuffer* threadBuffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        int index = registry().threadCount.fetch_add(1);
+        if (index >= MAX_THREADS) {
+            return nullptr;
+        }
+        buffer = new ThreadBuffer();
+        buffer->threadId = index + 1;
+        registry().buffers[index].store(buffer, std::memory_order_release);
+    }
+    return buffer;
+}
+
+inline uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - registry().epoch).count();
+}
+
+class Span {
+    private:
+        const char* name;
+        uint64_t start;
+
+    public:
+        Span(const char* name): name(name), start(now()) {}
+
+        ~Span() {
+            ThreadBuffer* buffer = threadBuffer();
+            if (buffer) {
+                buffer->record({ name, start, now() - start });
+            }
+        }
+};
+
+// Best called from the main thread; spans a thread records during the write
+// may come out torn, the rest of the file stays valid
+inline void write(const std::string& path) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        std::cerr << "[Error] Could not write trace file " << path << std::endl;
+        return;
+    }
+
+    file << "{\"traceEvents\":[\n";
+    bool first = true;
+    int threadCount = std::min(registry().threadCount.load(), MAX_THREADS);
+    for (int t = 0; t < threadCount; ++t) {
+        ThreadBuffer* buffer = registry().buffers[t].load(std::memory_order_acquire);
+        if (!buffer) continue;
+
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t begin = written > ThreadBuffer::CAPACITY ? written - ThreadBuffer::CAPACITY : 0;
+        for (uint64_t i = begin; i < written; ++i) {
+            const SpanEvent& event = buffer->events[i & (ThreadBuffer::CAPACITY - 1)];
+            file << (first ? "" : ",\n")
+                 << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                 << ",\"ts\":" << event.startNanoseconds / 1000.0
+                 << ",\"dur\":" << event.durationNanoseconds / 1000.0 << "}";
+            first = false;
+        }
+    }
+    file << "\n]}\n";
+    std::cerr << "[Trace] Written to " << path << std::endl;
+}
+
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) trace::Span TRACE_CONCAT(traceSpan, __LINE__)(name)
+#define TRACE_WRITE(path) trace::write(path)
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_WRITE(path) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,630 @@
+#ifndef TRAININGDATA_H
+#define TRAININGDATA_H
+
+#include "Game.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Layout of a training file: FileHeader | chunk | chunk | ...
+// A chunk is a ChunkHeader followed by its columns, each starting on 8 bytes. Column i of
+// every chunk holds the same field for all the records of the chunk, stored as is (Raw)
+// or with its runs of zero bytes collapsed (ZeroRun), whichever is smaller.
+namespace trainingdata {
+
+const uint32_t MAGIC = 0x54335444;       // "T3TD"
+const uint32_t CHUNK_MAGIC = 0x5433434B; // "T3CK"
+const uint32_t FORMAT_VERSION = 1;
+
+enum Column : uint32_t {
+    Board,       // uint8_t[boardBytes]: occupancy before the lock, bit (y * depth + z) * width + x
+    Shape,       // uint8_t: shape id 0-6
+    Orientation, // uint32_t: the 4 cells relative to the piece's min corner, see orientationOf
+    X,           // int16_t: min corner of the locked piece
+    Y,
+    Z,
+    Lines,       // uint8_t: layers the lock cleared
+    FinalScore,  // int32_t: score of the game at its end
+    GameIndex,   // uint32_t: game of the record in the file, records of a game are contiguous
+    COLUMN_COUNT
+};
+
+enum Codec : uint32_t {
+    Raw,
+    ZeroRun // varint literal count, literal bytes, varint zero count, repeated
+};
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t formatVersion;
+    uint32_t rulesVersion; // Game::RULES_VERSION of the games recorded
+    uint32_t width, height, depth;
+    uint32_t boardBytes;
+    uint32_t reserved;
+    uint8_t padding[32];
+};
+
+struct ColumnInfo {
+    uint32_t codec;
+    uint32_t reserved;
+    uint64_t offset;      // From the start of the chunk
+    uint64_t storedBytes;
+    uint64_t rawBytes;
+};
+
+struct ChunkHeader {
+    uint32_t magic;
+    uint32_t records;
+    uint64_t chunkBytes; // Header included
+    ColumnInfo columns[COLUMN_COUNT];
+};
+
+static_assert(sizeof(FileHeader) == 64, "the first chunk starts on 8 bytes");
+static_assert(sizeof(ChunkHeader) % 8 == 0, "columns start on 8 bytes");
+
+inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline bool getVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7) {
+        uint8_t byte = *in++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Appends data to out, ZeroRun coded. Boards are mostly empty above the stack and small
+// integers have zero high bytes, so this is where most of the size goes.
+inline void encodeZeroRuns(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    size_t i = 0;
+    while (i < size) {
+        size_t literalStart = i;
+        // A single zero between literals costs more as a run than as a literal
+        while (i < size && (data[i] != 0 || (i + 1 < size && data[i + 1] != 0))) ++i;
+        putVarint(out, i - literalStart);
+        out.insert(out.end(), data + literalStart, data + i);
+        size_t zeroStart = i;
+        while (i < size && data[i] == 0) ++i;
+        putVarint(out, i - zeroStart);
+    }
+}
+
+// False when the input is corrupt or does not decode to exactly size bytes
+inline bool decodeZeroRuns(const uint8_t* in, size_t inSize, uint8_t* out, size_t size) {
+    const uint8_t* end = in + inSize;
+    size_t written = 0;
+    while (in < end) {
+        uint64_t literals, zeros;
+        if (!getVarint(in, end, literals) || literals > static_cast<uint64_t>(end - in) || literals > size - written) return false;
+        std::memcpy(out + written, in, literals);
+        in += literals;
+        written += literals;
+        if (!getVarint(in, end, zeros) || zeros > size - written) return false;
+        std::memset(out + written, 0, zeros);
+        written += zeros;
+    }
+    return written == size;
+}
+
+inline uint32_t boardBytesFor(int width, int height, int depth) {
+    return static_cast<uint32_t>((static_cast<uint64_t>(width) * height * depth + 7) / 8);
+}
+
+// Cells relative to the min corner, 2 bits per axis (a piece spans at most 4 cells), sorted:
+// equal for the orientations that fill the same cells
+inline uint32_t orientationOf(const Tetromino& tetromino, int& minX, int& minY, int& minZ) {
+    const std::vector<Block>& blocks = tetromino.getBlocks();
+    minX = minY = minZ = INT32_MAX;
+    for (const Block& block : blocks) {
+        glm::vec3 pos = block.getPosition();
+        minX = std::min(minX, static_cast<int>(pos.x));
+        minY = std::min(minY, static_cast<int>(pos.y));
+        minZ = std::min(minZ, static_cast<int>(pos.z));
+    }
+    uint8_t cells[4] = { 0, 0, 0, 0 };
+    int count = std::min(static_cast<int>(blocks.size()), 4);
+    for (int b = 0; b < count; ++b) {
+        glm::vec3 pos = blocks[b].getPosition();
+        cells[b] = static_cast<uint8_t>((((static_cast<int>(pos.y) - minY) & 3) << 4) | (((static_cast<int>(pos.z) - minZ) & 3) << 2)
+                                        | ((static_cast<int>(pos.x) - minX) & 3));
+    }
+    std::sort(cells, cells + count);
+    return cells[0] | (cells[1] << 8) | (cells[2] << 16) | (static_cast<uint32_t>(cells[3]) << 24);
+}
+
+}
+
+// Records by column, in the order of the file's columns
+struct TrainingColumns {
+    std::vector<uint8_t> boards;
+    std::vector<uint8_t> shapes;
+    std::vector<uint32_t> orientations;
+    std::vector<int16_t> x, y, z;
+    std::vector<uint8_t> lines;
+    std::vector<int32_t> finalScores;
+    std::vector<uint32_t> games;
+
+    size_t size() const {
+        return shapes.size();
+    }
+
+    void reserve(size_t records, size_t boardBytes) {
+        boards.reserve(records * boardBytes);
+        shapes.reserve(records);
+        orientations.reserve(records);
+        x.reserve(records);
+        y.reserve(records);
+        z.reserve(records);
+        lines.reserve(records);
+        finalScores.reserve(records);
+        games.reserve(records);
+    }
+
+    void clear() {
+        boards.clear();
+        shapes.clear();
+        orientations.clear();
+        x.clear();
+        y.clear();
+        z.clear();
+        lines.clear();
+        finalScores.clear();
+        games.clear();
+    }
+
+    const uint8_t* columnData(trainingdata::Column column) const {
+        switch (column) {
+            case trainingdata::Board: return boards.data();
+            case trainingdata::Shape: return shapes.data();
+            case trainingdata::Orientation: return reinterpret_cast<const uint8_t*>(orientations.data());
+            case trainingdata::X: return reinterpret_cast<const uint8_t*>(x.data());
+            case trainingdata::Y: return reinterpret_cast<const uint8_t*>(y.data());
+            case trainingdata::Z: return reinterpret_cast<const uint8_t*>(z.data());
+            case trainingdata::Lines: return lines.data();
+            case trainingdata::FinalScore: return reinterpret_cast<const uint8_t*>(finalScores.data());
+            default: return reinterpret_cast<const uint8_t*>(games.data());
+        }
+    }
+
+    size_t columnBytes(trainingdata::Column column) const {
+        switch (column) {
+            case trainingdata::Board: return boards.size();
+            case trainingdata::Shape: return shapes.size();
+            case trainingdata::Orientation: return orientations.size() * sizeof(uint32_t);
+            case trainingdata::X: return x.size() * sizeof(int16_t);
+            case trainingdata::Y: return y.size() * sizeof(int16_t);
+            case trainingdata::Z: return z.size() * sizeof(int16_t);
+            case trainingdata::Lines: return lines.size();
+            case trainingdata::FinalScore: return finalScores.size() * sizeof(int32_t);
+            default: return games.size() * sizeof(uint32_t);
+        }
+    }
+};
+
+// Streams finished games into a training file. Records are added a game at a time, once
+// its final score is known, to the chunk being filled. A full chunk goes to the writer
+// thread, which compresses and writes it while the other chunk fills: the games never wait
+// on the disk. Should the writer still be busy, the chunk keeps filling past its size
+// until the writer is free. Games from several threads may be added concurrently.
+class TrainingExporter {
+    private:
+        FILE* output = nullptr;
+        uint32_t boardBytes = 0;
+        size_t chunkRecords;
+
+        TrainingColumns chunks[2];
+        int filling = 0;        // Chunk the games go to, the other one belongs to the writer while writing
+        bool writing = false;
+        bool stopping = false;
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+        std::condition_variable written;
+        std::thread writer;
+
+        uint32_t gameCount = 0;
+        uint64_t records = 0;
+        uint64_t chunkCount = 0;
+        uint64_t rawBytes = 0;
+        uint64_t storedBytes = 0;
+
+        // Only the writer touches it
+        std::vector<uint8_t> encoded;
+
+        void writeChunk(const TrainingColumns& chunk) {
+            using namespace trainingdata;
+            encoded.resize(sizeof(ChunkHeader));
+            ChunkHeader header = {};
+            header.magic = CHUNK_MAGIC;
+            header.records = static_cast<uint32_t>(chunk.size());
+            uint64_t chunkRaw = 0;
+            for (uint32_t c = 0; c < COLUMN_COUNT; ++c) {
+                Column column = static_cast<Column>(c);
+                const uint8_t* data = chunk.columnData(column);
+                size_t bytes = chunk.columnBytes(column);
+                ColumnInfo& info = header.columns[c];
+                info.offset = encoded.size();
+                info.rawBytes = bytes;
+                encodeZeroRuns(data, bytes, encoded);
+                info.storedBytes = encoded.size() - info.offset;
+                info.codec = ZeroRun;
+                if (info.storedBytes >= bytes) {
+                    encoded.resize(info.offset);
+                    encoded.insert(encoded.end(), data, data + bytes);
+                    info.storedBytes = bytes;
+                    info.codec = Raw;
+                }
+                encoded.resize((encoded.size() + 7) & ~static_cast<size_t>(7));
+                chunkRaw += bytes;
+            }
+            header.chunkBytes = encoded.size();
+            std::memcpy(encoded.data(), &header, sizeof(header));
+            if (std::fwrite(encoded.data(), 1, encoded.size(), output) != encoded.size()) {
+                std::cerr << "[Error] Could not write a training chunk" << std::endl;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            chunkCount++;
+            rawBytes += chunkRaw;
+            storedBytes += encoded.size();
+        }
+
+        void run() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                wakeUp.wait(lock, [this] { return stopping || writing; });
+                if (!writing) break; // Stopping with nothing left to write
+                TrainingColumns& chunk = chunks[filling ^ 1];
+                lock.unlock();
+                writeChunk(chunk);
+                chunk.clear();
+                lock.lock();
+                writing = false;
+                written.notify_all();
+            }
+            std::fflush(output);
+        }
+
+        // With the lock held and the writer idle
+        void handOff() {
+            filling ^= 1;
+            writing = true;
+            wakeUp.notify_one();
+        }
+
+    public:
+        // chunkRecords: records per chunk, the unit the writer compresses and a reader maps
+        TrainingExporter(const std::string& path, int width, int height, int depth, size_t chunkRecords = 4096)
+            : boardBytes(trainingdata::boardBytesFor(width, height, depth)), chunkRecords(std::max<size_t>(1, chunkRecords)) {
+            output = std::fopen(path.c_str(), "wb");
+            if (!output) {
+                std::cerr << "[Error] Cannot open training output " << path << std::endl;
+                return;
+            }
+            trainingdata::FileHeader header = {};
+            header.magic = trainingdata::MAGIC;
+            header.formatVersion = trainingdata::FORMAT_VERSION;
+            header.rulesVersion = Game::RULES_VERSION;
+            header.width = width;
+            header.height = height;
+            header.depth = depth;
+            header.boardBytes = boardBytes;
+            std::fwrite(&header, sizeof(header), 1, output);
+            // Room for a few long games past the chunk size before a vector grows
+            for (TrainingColumns& chunk : chunks) {
+                chunk.reserve(this->chunkRecords + 1024, boardBytes);
+            }
+            writer = std::thread(&TrainingExporter::run, this);
+        }
+
+        TrainingExporter(const TrainingExporter&) = delete;
+        TrainingExporter& operator=(const TrainingExporter&) = delete;
+
+        ~TrainingExporter() {
+            finish();
+        }
+
+        bool isOpen() const {
+            return output != nullptr;
+        }
+
+        uint32_t getBoardBytes() const {
+            return boardBytes;
+        }
+
+        // Copies the records of one game; their FinalScore and GameIndex columns are filled here
+        void addGame(const TrainingColumns& game, int finalScore) {
+            if (!writer.joinable() || game.size() == 0) return;
+            std::lock_guard<std::mutex> lock(mutex);
+            TrainingColumns& chunk = chunks[filling];
+            chunk.boards.insert(chunk.boards.end(), game.boards.begin(), game.boards.end());
+            chunk.shapes.insert(chunk.shapes.end(), game.shapes.begin(), game.shapes.end());
+            chunk.orientations.insert(chunk.orientations.end(), game.orientations.begin(), game.orientations.end());
+            chunk.x.insert(chunk.x.end(), game.x.begin(), game.x.end());
+            chunk.y.insert(chunk.y.end(), game.y.begin(), game.y.end());
+            chunk.z.insert(chunk.z.end(), game.z.begin(), game.z.end());
+            chunk.lines.insert(chunk.lines.end(), game.lines.begin(), game.lines.end());
+            chunk.finalScores.insert(chunk.finalScores.end(), game.size(), finalScore);
+            chunk.games.insert(chunk.games.end(), game.size(), gameCount);
+            gameCount++;
+            records += game.size();
+            if (chunk.size() >= chunkRecords && !writing) {
+                handOff();
+            }
+        }
+
+        // Writes the last chunk and closes the file; nothing is added afterwards
+        void finish() {
+            if (!writer.joinable()) return;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                written.wait(lock, [this] { return !writing; });
+                if (chunks[filling].size() > 0) {
+                    handOff();
+                }
+                stopping = true;
+            }
+            wakeUp.notify_one();
+            writer.join();
+            std::fclose(output);
+            output = nullptr;
+        }
+
+        // The game reports on stderr, whose stdout may carry a --capture video
+        void report(FILE* out = stdout) {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::fprintf(out, "[Export] %llu records of %u games in %llu chunks, %llu bytes stored for %llu (%.1f%%)\n",
+                         (unsigned long long)records, gameCount, (unsigned long long)chunkCount, (unsigned long long)storedBytes,
+                         (unsigned long long)rawBytes, rawBytes ? 100.0 * storedBytes / rawBytes : 0.0);
+        }
+
+        uint64_t getRecords() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return records;
+        }
+};
+
+// Turns the events of one Game into records: the board each piece lands on is packed when
+// the piece spawns, and the record is made when it locks. The records of a game are kept
+// until its GameOver gives their final score, then handed to the exporter.
+//
+// observe() must run at least every GameEventBuffer::CAPACITY events, in practice after
+// each update. A game whose events overflowed is dropped. Garbage added by a versus
+// opponent is not seen, such games should not be exported.
+class TrainingRecorder {
+    private:
+        TrainingExporter& exporter;
+        GameEventReader reader;
+        TrainingColumns game;
+        std::vector<uint8_t> spawnBoard; // Board the falling piece will lock on
+        int shape = 0;
+        int score = 0;
+        bool recording = false;
+
+        void packBoard(const Grid& grid) {
+            std::fill(spawnBoard.begin(), spawnBoard.end(), 0);
+            const int width = grid.getWidth(), depth = grid.getDepth();
+            grid.forEachOccupiedCell([&](int x, int y, int z, uint8_t) {
+                size_t bit = (static_cast<size_t>(y) * depth + z) * width + x;
+                spawnBoard[bit >> 3] |= static_cast<uint8_t>(1 << (bit & 7));
+            });
+        }
+
+        void addRecord(const Game& source) {
+            int x, y, z;
+            uint32_t orientation = trainingdata::orientationOf(source.getLastLockedTetromino(), x, y, z);
+            game.boards.insert(game.boards.end(), spawnBoard.begin(), spawnBoard.end());
+            game.shapes.push_back(static_cast<uint8_t>(shape));
+            game.orientations.push_back(orientation);
+            game.x.push_back(static_cast<int16_t>(x));
+            game.y.push_back(static_cast<int16_t>(y));
+            game.z.push_back(static_cast<int16_t>(z));
+            game.lines.push_back(0);
+        }
+
+    public:
+        TrainingRecorder(TrainingExporter& exporter): exporter(exporter), spawnBoard(exporter.getBoardBytes()) {
+            game.reserve(4096, exporter.getBoardBytes());
+        }
+
+        // Drains the new events of game: records locks, hands the game over once it ends
+        void observe(const Game& source) {
+            GameEvent event;
+            while (reader.poll(source.getEvents(), event)) {
+                switch (event.type) {
+                    case GameEventType::GameStarted:
+                        // A game restarted before its end is exported with the score it had
+                        if (recording) exporter.addGame(game, score);
+                        game.clear();
+                        score = 0;
+                        recording = true;
+                        break;
+                    case GameEventType::PieceSpawned:
+                        shape = event.value;
+                        packBoard(source.getGrid());
+                        break;
+                    case GameEventType::PieceLocked:
+                        if (recording) addRecord(source);
+                        break;
+                    case GameEventType::LayersCleared:
+                        if (recording && game.size() > 0) game.lines.back() = event.layerCount;
+                        score = event.value;
+                        break;
+                    case GameEventType::GameOver:
+                        if (recording) exporter.addGame(game, event.value);
+                        game.clear();
+                        recording = false;
+                        break;
+                    default:
+                        break;
+                }
+            }
+            if (reader.checkOverflow()) {
+                game.clear();
+                recording = false;
+            }
+        }
+
+        // Follows a new Game object from its first event on
+        void follow(const Game& source) {
+            finish();
+            reader = GameEventReader();
+            observe(source);
+        }
+
+        // Hands over the game in progress, if any, with its current score
+        void finish() {
+            if (recording) exporter.addGame(game, score);
+            game.clear();
+            recording = false;
+        }
+};
+
+// Read-only view of a training file. The file is memory-mapped and only the chunk headers
+// are read when it opens; a Raw column is used in place, a ZeroRun one is decoded into a
+// buffer of the reader. A chunk cut short by a crash ends the file.
+class TrainingReader {
+    private:
+        void* memory = MAP_FAILED;
+        size_t mappedSize = 0;
+        trainingdata::FileHeader header = {};
+        std::vector<const trainingdata::ChunkHeader*> chunkHeaders;
+        std::vector<uint8_t> decoded[trainingdata::COLUMN_COUNT];
+        uint64_t recordCount = 0;
+
+    public:
+        // Columns of one chunk, valid until the next readChunk of the same reader
+        struct Chunk {
+            uint32_t records = 0;
+            const uint8_t* boards = nullptr; // getBoardBytes() per record
+            const uint8_t* shapes = nullptr;
+            const uint32_t* orientations = nullptr;
+            const int16_t* x = nullptr;
+            const int16_t* y = nullptr;
+            const int16_t* z = nullptr;
+            const uint8_t* lines = nullptr;
+            const int32_t* finalScores = nullptr;
+            const uint32_t* games = nullptr;
+        };
+
+        TrainingReader(const std::string& path) {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                std::cerr << "[Error] Cannot open training file " << path << std::endl;
+                return;
+            }
+            struct stat status;
+            if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(trainingdata::FileHeader)) {
+                std::cerr << "[Error] Not a training file: " << path << std::endl;
+                close(fd);
+                return;
+            }
+            mappedSize = static_cast<size_t>(status.st_size);
+            memory = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (memory == MAP_FAILED) {
+                std::cerr << "[Error] Could not map the training file " << path << std::endl;
+                return;
+            }
+            const uint8_t* bytes = static_cast<const uint8_t*>(memory);
+            std::memcpy(&header, bytes, sizeof(header));
+            if (header.magic != trainingdata::MAGIC || header.formatVersion != trainingdata::FORMAT_VERSION) {
+                std::cerr << "[Error] Not a training file, or of another version: " << path << std::endl;
+                munmap(memory, mappedSize);
+                memory = MAP_FAILED;
+                return;
+            }
+            size_t offset = sizeof(header);
+            while (offset + sizeof(trainingdata::ChunkHeader) <= mappedSize) {
+                const trainingdata::ChunkHeader* chunk = reinterpret_cast<const trainingdata::ChunkHeader*>(bytes + offset);
+                if (chunk->magic != trainingdata::CHUNK_MAGIC || chunk->chunkBytes < sizeof(*chunk) || chunk->chunkBytes > mappedSize - offset) break;
+                chunkHeaders.push_back(chunk);
+                recordCount += chunk->records;
+                offset += chunk->chunkBytes;
+            }
+        }
+
+        TrainingReader(const TrainingReader&) = delete;
+        TrainingReader& operator=(const TrainingReader&) = delete;
+
+        ~TrainingReader() {
+            if (memory != MAP_FAILED) {
+                munmap(memory, mappedSize);
+            }
+        }
+
+        bool isOpen() const {
+            return memory != MAP_FAILED;
+        }
+
+        int getWidth() const { return static_cast<int>(header.width); }
+        int getHeight() const { return static_cast<int>(header.height); }
+        int getDepth() const { return static_cast<int>(header.depth); }
+        uint32_t getBoardBytes() const { return header.boardBytes; }
+        uint32_t getRulesVersion() const { return header.rulesVersion; }
+        size_t getChunkCount() const { return chunkHeaders.size(); }
+        uint64_t getRecordCount() const { return recordCount; }
+
+        // False when a column is corrupt
+        bool readChunk(size_t index, Chunk& chunk) {
+            using namespace trainingdata;
+            const ChunkHeader& source = *chunkHeaders[index];
+            const uint8_t* base = reinterpret_cast<const uint8_t*>(&source);
+            const size_t itemBytes[COLUMN_COUNT] = { header.boardBytes, 1, 4, 2, 2, 2, 1, 4, 4 };
+            const uint8_t* columns[COLUMN_COUNT];
+            for (uint32_t c = 0; c < COLUMN_COUNT; ++c) {
+                const ColumnInfo& info = source.columns[c];
+                if (info.rawBytes != itemBytes[c] * source.records || info.offset > source.chunkBytes
+                    || info.storedBytes > source.chunkBytes - info.offset || (info.codec == Raw && info.storedBytes != info.rawBytes)) {
+                    return false;
+                }
+                if (info.codec == Raw) {
+                    columns[c] = base + info.offset;
+                } else if (info.codec == ZeroRun) {
+                    decoded[c].resize(static_cast<size_t>(info.rawBytes) + 8);
+                    // Decoded columns start on 8 bytes like the mapped ones
+                    uint8_t* target = decoded[c].data();
+                    target += (8 - reinterpret_cast<uintptr_t>(target) % 8) % 8;
+                    if (!decodeZeroRuns(base + info.offset, info.storedBytes, target, info.rawBytes)) return false;
+                    columns[c] = target;
+                } else {
+                    return false;
+                }
+            }
+            chunk.records = source.records;
+            chunk.boards = columns[Board];
+            chunk.shapes = columns[Shape];
+            chunk.orientations = reinterpret_cast<const uint32_t*>(columns[Orientation]);
+            chunk.x = reinterpret_cast<const int16_t*>(columns[X]);
+            chunk.y = reinterpret_cast<const int16_t*>(columns[Y]);
+            chunk.z = reinterpret_cast<const int16_t*>(columns[Z]);
+            chunk.lines = columns[Lines];
+            chunk.finalScores = reinterpret_cast<const int32_t*>(columns[FinalScore]);
+            chunk.games = reinterpret_cast<const uint32_t*>(columns[GameIndex]);
+            return true;
+        }
+
+        // Bit of cell (x, y, z) in a board of the Board column
+        bool isOccupied(const uint8_t* board, int x, int y, int z) const {
+            size_t bit = (static_cast<size_t>(y) * header.depth + z) * header.width + x;
+            return (board[bit >> 3] >> (bit & 7)) & 1;
+        }
+};
+
+#endif
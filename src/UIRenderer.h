@@ -0,0 +1,289 @@
+#ifndef UIRENDERER_H
+#define UIRENDERER_H
+
+#include "Shader.h"
+#include "Metrics.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+// Vertex data of a retained UI screen. The geometry is only rebuilt and
+// uploaded when the layout or the hover state changes.
+class UIBatch {
+    private:
+        GLuint VAO = 0, VBO = 0;
+        size_t uploadedCapacity = 0; // Floats the VBO can hold
+
+        friend class UIRenderer;
+
+    public:
+        static const int FLOATS_PER_VERTEX = 8; // vec2 position, vec2 tex coords, vec4 color
+
+        std::vector<float> vertices;
+
+        void clear() {
+            vertices.clear();
+        }
+
+        int vertexCount() const {
+            return static_cast<int>(vertices.size() / FLOATS_PER_VERTEX);
+        }
+
+        void upload() {
+            if (VAO == 0) {
+                glGenVertexArrays(1, &VAO);
+                glGenBuffers(1, &VBO);
+                glBindVertexArray(VAO);
+                glBindBuffer(GL_ARRAY_BUFFER, VBO);
+                GLsizei stride = FLOATS_PER_VERTEX * sizeof(float);
+                glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)0);
+                glEnableVertexAttribArray(0);
+                glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(2 * sizeof(float)));
+                glEnableVertexAttribArray(1);
+                glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)(4 * sizeof(float)));
+                glEnableVertexAttribArray(2);
+                glBindVertexArray(0);
+            }
+
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            if (vertices.size() > uploadedCapacity) {
+                uploadedCapacity = vertices.capacity();
+                glBufferData(GL_ARRAY_BUFFER, uploadedCapacity * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+            }
+            glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(float), vertices.data());
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
+        void cleanUp() {
+            glDeleteVertexArrays(1, &VAO);
+            glDeleteBuffers(1, &VBO);
+            VAO = VBO = 0;
+            uploadedCapacity = 0;
+        }
+
+        ~UIBatch() {
+            cleanUp();
+        }
+};
+
+// Place of a character in the glyph atlas of UIRenderer, and its metrics
+struct AtlasGlyph {
+    glm::vec2 uvMin, uvMax; // Top-left and bottom-right texture coordinates
+    glm::ivec2 Size;        // Size of the glyph
+    glm::ivec2 Bearing;     // Offset from the baseline
+    GLuint Advance;         // Advance to the next character, in pixels
+};
+
+// Draws UIBatches with a single program and a single glyph atlas texture, so a
+// whole screen of quads and text is one draw call.
+class UIRenderer : public Shader {
+    private:
+        static const int ATLAS_WIDTH = 1024;
+        static const int ATLAS_HEIGHT = 512;
+        static const int CELL_SIZE = 64; // 16 x 8 cells, one per ASCII character
+
+        std::array<AtlasGlyph, 128> glyphs{};
+        GLuint atlasTexture = 0;
+        glm::vec2 whiteUV; // Center of a solid texel, used for untextured quads
+        glm::mat4 projection;
+
+        static constexpr const char* UI_VERTEX_SHADER = R"(
+        #version 330 core
+        layout (location = 0) in vec2 aPos;
+        layout (location = 1) in vec2 aTexCoords;
+        layout (location = 2) in vec4 aColor;
+
+        uniform mat4 projection;
+        uniform vec2 offset; // Lets a range of the batch move without being rebuilt
+
+        out vec2 TexCoords;
+        out vec4 Color;
+
+        void main() {
+            gl_Position = projection * vec4(aPos + offset, 0.0, 1.0);
+            TexCoords = aTexCoords;
+            Color = aColor;
+        }
+        )";
+
+        static constexpr const char* UI_FRAGMENT_SHADER = R"(
+        #version 330 core
+        in vec2 TexCoords;
+        in vec4 Color;
+        out vec4 color;
+
+        uniform sampler2D atlas;
+
+        void main() {
+            color = vec4(Color.rgb, Color.a * texture(atlas, TexCoords).r);
+        }
+        )";
+
+        void initializeAtlas(const char* fontPath) {
+            std::vector<unsigned char> pixels(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+
+            // Cell 0 (the NUL character) holds a solid patch for untextured quads
+            for (int y = 0; y < 4; ++y) {
+                for (int x = 0; x < 4; ++x) {
+                    pixels[y * ATLAS_WIDTH + x] = 255;
+                }
+            }
+            whiteUV = glm::vec2(2.0f / ATLAS_WIDTH, 2.0f / ATLAS_HEIGHT);
+
+            FT_Library ft;
+            if (FT_Init_FreeType(&ft)) {
+                std::cerr << "[Error] Could not initialize FreeType Library!" << std::endl;
+                return;
+            }
+
+            FT_Face face;
+            if (FT_New_Face(ft, fontPath, 0, &face)) {
+                std::cerr << "[Error] Failed to load font: " << fontPath << std::endl;
+                FT_Done_FreeType(ft);
+                return;
+            }
+
+            FT_Set_Pixel_Sizes(face, 0, 48);
+
+            for (unsigned char c = 32; c < 128; c++) {
+                if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
+                    std::cerr << "[Error] Failed to load character: " << c << std::endl;
+                    continue;
+                }
+
+                const FT_Bitmap& bitmap = face->glyph->bitmap;
+                int cellX = (c % 16) * CELL_SIZE;
+                int cellY = (c / 16) * CELL_SIZE;
+                int w = std::min<int>(bitmap.width, CELL_SIZE);
+                int h = std::min<int>(bitmap.rows, CELL_SIZE);
+                for (int y = 0; y < h; ++y) {
+                    for (int x = 0; x < w; ++x) {
+                        pixels[(cellY + y) * ATLAS_WIDTH + cellX + x] = bitmap.buffer[y * bitmap.pitch + x];
+                    }
+                }
+
+                AtlasGlyph& glyph = glyphs[c];
+                glyph.uvMin = glm::vec2((float)cellX / ATLAS_WIDTH, (float)cellY / ATLAS_HEIGHT);
+                glyph.uvMax = glm::vec2((float)(cellX + w) / ATLAS_WIDTH, (float)(cellY + h) / ATLAS_HEIGHT);
+                glyph.Size = glm::ivec2(w, h);
+                glyph.Bearing = glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+                glyph.Advance = static_cast<GLuint>(face->glyph->advance.x >> 6);
+            }
+
+            FT_Done_Face(face);
+            FT_Done_FreeType(ft);
+
+            glGenTextures(1, &atlasTexture);
+            glBindTexture(GL_TEXTURE_2D, atlasTexture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+
+        static void appendVertex(UIBatch& batch, float x, float y, glm::vec2 uv, const glm::vec4& color) {
+            batch.vertices.insert(batch.vertices.end(), { x, y, uv.x, uv.y, color.x, color.y, color.z, color.w });
+        }
+
+        // Two triangles, uv0 is used for the top-left corner and uv1 for the bottom-right one
+        static void appendRect(UIBatch& batch, float x, float y, float w, float h, glm::vec2 uv0, glm::vec2 uv1, const glm::vec4& color) {
+            appendVertex(batch, x,     y + h, uv0, color);
+            appendVertex(batch, x,     y,     glm::vec2(uv0.x, uv1.y), color);
+            appendVertex(batch, x + w, y,     uv1, color);
+
+            appendVertex(batch, x,     y + h, uv0, color);
+            appendVertex(batch, x + w, y,     uv1, color);
+            appendVertex(batch, x + w, y + h, glm::vec2(uv1.x, uv0.y), color);
+        }
+
+    public:
+        UIRenderer(): Shader(UI_VERTEX_SHADER, UI_FRAGMENT_SHADER) {
+            projection = glm::ortho(0.0f, 1600.0f, 0.0f, 1200.0f);
+            initializeAtlas("./utils/Super_cartoon.ttf");
+        }
+
+        void addQuad(UIBatch& batch, float x, float y, float w, float h, const glm::vec3& color) {
+            appendRect(batch, x, y, w, h, whiteUV, whiteUV, glm::vec4(color.x, color.y, color.z, 1.0f));
+        }
+
+        // TextShader::queueText lays text out the same way
+        void addText(UIBatch& batch, const char* text, float x, float y, float scale, const glm::vec3& color) {
+            glm::vec4 rgba(color.x, color.y, color.z, 1.0f);
+            for (; *text; ++text) {
+                char c = *text;
+                if (c < 32) {
+                    continue;
+                }
+                const AtlasGlyph& glyph = glyphs[static_cast<unsigned char>(c)];
+                float xpos = x + glyph.Bearing.x * scale;
+                float ypos = y - (glyph.Size.y - glyph.Bearing.y) * scale;
+                appendRect(batch, xpos, ypos, glyph.Size.x * scale, glyph.Size.y * scale, glyph.uvMin, glyph.uvMax, rgba);
+                x += glyph.Advance * scale;
+            }
+        }
+
+        // Also used by TextShader, which draws the HUD and debug text from the same atlas.
+        // c must be below 128.
+        const AtlasGlyph& getGlyph(unsigned char c) const {
+            return glyphs[c];
+        }
+
+        GLuint getAtlasTexture() const {
+            return atlasTexture;
+        }
+
+        // Advance of the whole text, as laid out by addText
+        float textWidth(const char* text, float scale) const {
+            float width = 0.0f;
+            for (; *text; ++text) {
+                if (*text >= 32) width += glyphs[static_cast<unsigned char>(*text)].Advance * scale;
+            }
+            return width;
+        }
+
+        // Height of the tallest glyph of text above the baseline
+        float textAscent(const char* text, float scale) const {
+            int ascent = 0;
+            for (; *text; ++text) {
+                if (*text >= 32) ascent = std::max(ascent, glyphs[static_cast<unsigned char>(*text)].Bearing.y);
+            }
+            return ascent * scale;
+        }
+
+        // Draws count vertices of the batch starting at first, translated by offset
+        void draw(const UIBatch& batch, int first, int count, glm::vec2 offset = glm::vec2(0.0f)) {
+            if (count <= 0 || batch.VAO == 0) return;
+
+            use();
+            setUniformMatrix4fv("projection", projection);
+            glUniform2f(glGetUniformLocation(ID, "offset"), offset.x, offset.y);
+            glDisable(GL_DEPTH_TEST);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, atlasTexture);
+            glBindVertexArray(batch.VAO);
+            glDrawArrays(GL_TRIANGLES, first, count);
+            metrics::increment(metrics::Counter::GlyphsDrawn, count / 6);
+            glBindVertexArray(0);
+            glEnable(GL_DEPTH_TEST);
+        }
+
+        void draw(const UIBatch& batch) {
+            draw(batch, 0, batch.vertexCount());
+        }
+
+        ~UIRenderer() {
+            glDeleteTextures(1, &atlasTexture);
+        }
+};
+
+#endif
@@ -0,0 +1,338 @@
+#ifndef VERSUS_H
+#define VERSUS_H
+
+#include "Environment.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Two games played against each other: clearing n >= 2 layers at once pushes
+// n - 1 garbage layers under the opponent's stack. Both games start from the
+// same seed and the garbage holes only depend on the tick, so the whole match
+// follows from the inputs of the two players.
+class VersusMatch {
+    private:
+        Game games[2];
+        int width, depth;
+        unsigned seed;
+        uint32_t tick = 0;
+        int round = 0;
+        std::array<int, 2> wins{};
+
+        static uint32_t mix(uint32_t value) {
+            value ^= value >> 16;
+            value *= 0x7feb352du;
+            value ^= value >> 15;
+            value *= 0x846ca68bu;
+            value ^= value >> 16;
+            return value;
+        }
+
+        static void hashValue(uint64_t& hash, uint64_t value) {
+            hash = (hash ^ value) * 1099511628211ull;
+        }
+
+    public:
+        static constexpr float TICK_SECONDS = 1.0f / 60.0f;
+
+        struct Snapshot {
+            std::array<Game::Snapshot, 2> games;
+            uint32_t tick;
+            int round;
+            std::array<int, 2> wins;
+        };
+
+        VersusMatch(int width, int height, int depth, unsigned seed)
+            : games{Game(width, height, depth, seed), Game(width, height, depth, seed)}, width(width), depth(depth), seed(seed) {}
+
+        // One tick: both actions (EnvAction values), both updates, then the garbage of the layers
+        // cleared during the tick. A round ends when a game is over; the other player wins it.
+        void step(const std::array<uint8_t, 2>& actions) {
+            std::array<int, 2> cleared;
+            for (int p = 0; p < 2; ++p) {
+                int linesBefore = games[p].getTotalLinesCleared();
+                if (actions[p] < static_cast<uint8_t>(EnvAction::Count)) {
+                    applyAction(games[p], static_cast<EnvAction>(actions[p]));
+                }
+                games[p].update(TICK_SECONDS);
+                cleared[p] = games[p].getTotalLinesCleared() - linesBefore;
+            }
+            for (int p = 0; p < 2; ++p) {
+                if (cleared[p] >= 2) {
+                    uint32_t hole = mix(seed ^ (tick * 2u + p));
+                    games[1 - p].addGarbage(cleared[p] - 1, hole % width, (hole >> 16) % depth);
+                }
+            }
+            tick++;
+
+            bool running0 = games[0].getIsRunning(), running1 = games[1].getIsRunning();
+            if (!running0 || !running1) {
+                if (running0 != running1) {
+                    wins[running0 ? 0 : 1]++;
+                }
+                round++;
+                for (Game& game : games) {
+                    game.start(seed + round * 0x9e3779b9u);
+                }
+            }
+        }
+
+        void save(Snapshot& snapshot) const {
+            games[0].save(snapshot.games[0]);
+            games[1].save(snapshot.games[1]);
+            snapshot.tick = tick;
+            snapshot.round = round;
+            snapshot.wins = wins;
+        }
+
+        void restore(const Snapshot& snapshot) {
+            games[0].restore(snapshot.games[0]);
+            games[1].restore(snapshot.games[1]);
+            tick = snapshot.tick;
+            round = snapshot.round;
+            wins = snapshot.wins;
+        }
+
+        // Cheap fingerprint of a state, compared between peers to detect desyncs
+        static uint64_t checksum(const Snapshot& snapshot) {
+            uint64_t hash = 14695981039346656037ull;
+            hashValue(hash, snapshot.tick);
+            hashValue(hash, snapshot.round);
+            for (const Game::Snapshot& game : snapshot.games) {
+                hashValue(hash, game.grid.getHash());
+                for (const Block& block : game.currentTetromino.getBlocks()) {
+                    glm::vec3 pos = block.getPosition();
+                    hashValue(hash, (static_cast<uint64_t>(pos.x + 64) << 32) | (static_cast<uint64_t>(pos.y + 64) << 16) | static_cast<uint64_t>(pos.z + 64));
+                }
+                hashValue(hash, game.score);
+                hashValue(hash, game.linesClearedTotal);
+                hashValue(hash, game.nextShape);
+                hashValue(hash, game.isRunning);
+            }
+            return hash;
+        }
+
+        const Game& getGame(int player) const { return games[player]; }
+        uint32_t getTick() const { return tick; }
+        int getRound() const { return round; }
+        int getWins(int player) const { return wins[player]; }
+};
+
+// Datagram between two peers: the sender's inputs from firstTick on, stamped with
+// their tick and resent until acknowledged, so the next datagram covers a lost one.
+// Both peers run the same build, the struct goes over the wire as is.
+struct InputPacket {
+    static const uint32_t MAGIC = 0x54335653; // "T3VS"
+    static const int MAX_INPUTS = 64;
+
+    uint32_t magic;
+    uint32_t firstTick;    // Tick of actions[0]
+    uint32_t ackTick;      // The sender has every input of the receiver before this tick
+    uint32_t checksumTick; // The sender's state before this tick hashes to checksum, 0 when none yet
+    uint64_t checksum;
+    uint8_t count;
+    uint8_t actions[MAX_INPUTS];
+
+    size_t size() const {
+        return offsetof(InputPacket, actions) + count;
+    }
+};
+
+struct RollbackStats {
+    uint64_t ticks = 0;              // Ticks simulated for the first time
+    uint64_t rollbacks = 0;          // Frames that restored a snapshot
+    uint64_t resimulatedTicks = 0;
+    uint32_t maxRollbackTicks = 0;
+    double resimulationSeconds = 0.0;
+    double maxResimulationSeconds = 0.0; // Worst frame
+    uint64_t stalls = 0;             // Frames that waited because the remote inputs were too far behind
+    uint64_t checksumsCompared = 0;
+    uint64_t desyncs = 0;
+};
+
+// One peer of a versus match with rollback. Each frame simulates the next tick at
+// once with the local input and, until the remote input for that tick arrives, a
+// prediction of it. When a remote input contradicts the prediction, the next
+// advance() restores the snapshot taken before that tick and simulates again
+// every tick since, with the inputs now known, before moving on.
+class RollbackSession {
+    public:
+        // Ticks that can be simulated ahead of the last confirmed remote input, one snapshot each
+        static const uint32_t WINDOW = 32;
+        static const uint32_t CHECKSUM_INTERVAL = 60;
+
+    private:
+        static const uint32_t INPUT_HISTORY = 128; // Local inputs kept for resending, remote inputs received ahead
+        static constexpr uint32_t NO_ROLLBACK = UINT32_MAX;
+        // Most ticks of a player carry no input, so idle is the best guess
+        static const uint8_t PREDICTED_ACTION = static_cast<uint8_t>(EnvAction::Idle);
+
+        VersusMatch match;
+        int localPlayer;
+        uint32_t tick = 0;             // Next tick to simulate
+        uint32_t confirmedRemote = 0;  // Every remote input before this tick is known
+        uint32_t remoteAck = 0;        // The remote has every local input before this tick
+        uint32_t rollbackFrom = NO_ROLLBACK;
+
+        std::vector<VersusMatch::Snapshot> snapshots; // State before tick t in t % WINDOW
+        std::array<uint8_t, WINDOW> usedRemote;       // Remote input each simulated tick ran with
+        std::array<uint8_t, INPUT_HISTORY> localInputs;
+        std::array<uint8_t, INPUT_HISTORY> remoteInputs;
+        std::array<uint32_t, INPUT_HISTORY> remoteTicks;
+
+        // Checksums of confirmed states, every CHECKSUM_INTERVAL ticks
+        uint32_t nextChecksumTick = CHECKSUM_INTERVAL;
+        std::array<uint32_t, 8> checksumTicks{};
+        std::array<uint64_t, 8> checksums{};
+        uint32_t latestChecksumTick = 0;
+        uint32_t comparedChecksumTick = 0;
+        uint32_t remoteChecksumTick = 0; // Received before the local one was ready
+        uint64_t remoteChecksum = 0;
+
+        RollbackStats stats;
+
+        void simulate(uint32_t t) {
+            match.save(snapshots[t % WINDOW]);
+            uint8_t remote = remoteTicks[t % INPUT_HISTORY] == t ? remoteInputs[t % INPUT_HISTORY] : PREDICTED_ACTION;
+            usedRemote[t % WINDOW] = remote;
+            std::array<uint8_t, 2> actions;
+            actions[localPlayer] = localInputs[t % INPUT_HISTORY];
+            actions[1 - localPlayer] = remote;
+            match.step(actions);
+        }
+
+        void rollback() {
+            auto start = std::chrono::steady_clock::now();
+            uint32_t depth = tick - rollbackFrom;
+            match.restore(snapshots[rollbackFrom % WINDOW]);
+            for (uint32_t t = rollbackFrom; t < tick; ++t) {
+                simulate(t);
+            }
+            rollbackFrom = NO_ROLLBACK;
+
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            stats.rollbacks++;
+            stats.resimulatedTicks += depth;
+            stats.maxRollbackTicks = std::max(stats.maxRollbackTicks, depth);
+            stats.resimulationSeconds += seconds;
+            stats.maxResimulationSeconds = std::max(stats.maxResimulationSeconds, seconds);
+        }
+
+        void compareChecksum(uint32_t checksumTick, uint64_t local, uint64_t remote) {
+            if (checksumTick <= comparedChecksumTick) return;
+            comparedChecksumTick = checksumTick;
+            stats.checksumsCompared++;
+            if (local != remote) {
+                if (stats.desyncs++ == 0) {
+                    std::cerr << "[Error] Versus desync at tick " << checksumTick << std::endl;
+                }
+            }
+        }
+
+        // The state before tick t is final once every input before it is known
+        void recordChecksums() {
+            while (nextChecksumTick < tick && nextChecksumTick <= confirmedRemote) {
+                uint64_t value = VersusMatch::checksum(snapshots[nextChecksumTick % WINDOW]);
+                size_t slot = (nextChecksumTick / CHECKSUM_INTERVAL) % checksums.size();
+                checksumTicks[slot] = nextChecksumTick;
+                checksums[slot] = value;
+                latestChecksumTick = nextChecksumTick;
+                if (remoteChecksumTick == nextChecksumTick) {
+                    compareChecksum(nextChecksumTick, value, remoteChecksum);
+                }
+                nextChecksumTick += CHECKSUM_INTERVAL;
+            }
+        }
+
+        void addRemoteInput(uint32_t t, uint8_t action) {
+            if (t < confirmedRemote || t >= confirmedRemote + INPUT_HISTORY || remoteTicks[t % INPUT_HISTORY] == t) return;
+            remoteTicks[t % INPUT_HISTORY] = t;
+            remoteInputs[t % INPUT_HISTORY] = action;
+            if (t < tick && usedRemote[t % WINDOW] != action) {
+                rollbackFrom = std::min(rollbackFrom, t);
+            }
+            while (remoteTicks[confirmedRemote % INPUT_HISTORY] == confirmedRemote) {
+                confirmedRemote++;
+            }
+        }
+
+    public:
+        RollbackSession(int width, int height, int depth, unsigned seed, int localPlayer)
+            : match(width, height, depth, seed), localPlayer(localPlayer), snapshots(WINDOW) {
+            remoteTicks.fill(NO_ROLLBACK);
+        }
+
+        // Once per frame. Corrects the past if needed, then simulates the next tick with
+        // localAction. Returns false, without using localAction, when the remote inputs
+        // are so far behind that the snapshots could no longer cover a rollback.
+        bool advance(uint8_t localAction) {
+            if (rollbackFrom != NO_ROLLBACK) {
+                rollback();
+            }
+            recordChecksums();
+            if (tick >= confirmedRemote + WINDOW - 1) {
+                stats.stalls++;
+                return false;
+            }
+            localInputs[tick % INPUT_HISTORY] = localAction;
+            simulate(tick);
+            tick++;
+            stats.ticks++;
+            recordChecksums();
+            return true;
+        }
+
+        // Every local input the remote has not acknowledged yet, oldest first
+        void makePacket(InputPacket& packet) const {
+            packet.magic = InputPacket::MAGIC;
+            packet.firstTick = remoteAck;
+            packet.ackTick = confirmedRemote;
+            packet.count = static_cast<uint8_t>(std::min<uint32_t>(tick - remoteAck, InputPacket::MAX_INPUTS));
+            for (int i = 0; i < packet.count; ++i) {
+                packet.actions[i] = localInputs[(remoteAck + i) % INPUT_HISTORY];
+            }
+            size_t slot = (latestChecksumTick / CHECKSUM_INTERVAL) % checksums.size();
+            packet.checksumTick = latestChecksumTick;
+            packet.checksum = latestChecksumTick ? checksums[slot] : 0;
+        }
+
+        // Returns false for anything that is not an InputPacket
+        bool receive(const void* data, size_t size) {
+            InputPacket packet;
+            if (size < offsetof(InputPacket, actions) || size > sizeof(packet)) return false;
+            std::memcpy(&packet, data, size);
+            if (packet.magic != InputPacket::MAGIC || packet.count > InputPacket::MAX_INPUTS || size < packet.size()) return false;
+
+            remoteAck = std::max(remoteAck, std::min(packet.ackTick, tick));
+            for (int i = 0; i < packet.count; ++i) {
+                addRemoteInput(packet.firstTick + i, packet.actions[i]);
+            }
+            if (packet.checksumTick > comparedChecksumTick) {
+                size_t slot = (packet.checksumTick / CHECKSUM_INTERVAL) % checksums.size();
+                if (checksumTicks[slot] == packet.checksumTick) {
+                    compareChecksum(packet.checksumTick, checksums[slot], packet.checksum);
+                } else if (packet.checksumTick > latestChecksumTick) {
+                    remoteChecksumTick = packet.checksumTick;
+                    remoteChecksum = packet.checksum;
+                }
+            }
+            return true;
+        }
+
+        // Tick and checksum of the latest confirmed state, tick 0 before the first one
+        uint32_t getChecksumTick() const { return latestChecksumTick; }
+        uint64_t getChecksum() const { return checksums[(latestChecksumTick / CHECKSUM_INTERVAL) % checksums.size()]; }
+
+        const VersusMatch& getMatch() const { return match; }
+        int getLocalPlayer() const { return localPlayer; }
+        uint32_t getTick() const { return tick; }
+        uint32_t getConfirmedTick() const { return confirmedRemote; }
+        const RollbackStats& getStats() const { return stats; }
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+
+// Zobrist keys of the game state. Keys are derived from the coordinates with a
+// fixed mixing function instead of a random table, so they are the same in every
+// process and cost no memory to copy with a snapshot.
+//
+// A layer hashes to the XOR of the keys of its occupied (x, z) columns, which does
+// not depend on its height. The board hash combines every non-empty layer with
+// its index, so clearing a layer only re-mixes the layer hashes that moved down
+// instead of rehashing their cells. An empty board hashes to 0.
+namespace zobrist {
+
+inline uint64_t mix(uint64_t value) {
+    value += 0x9e3779b97f4a7c15ull;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+inline uint64_t columnKey(int x, int z) {
+    return mix((static_cast<uint64_t>(static_cast<uint32_t>(z)) << 32) | static_cast<uint32_t>(x));
+}
+
+// Contribution of a layer to the board hash
+inline uint64_t layerKey(uint64_t layerHash, int y) {
+    return layerHash ? mix(layerHash ^ mix(0x4c41594552ull + static_cast<uint64_t>(y))) : 0; // "LAYER"
+}
+
+// Cells of the falling piece, distinct from the board cells
+inline uint64_t pieceKey(int x, int y, int z) {
+    return mix(0x5049454345ull ^ mix((static_cast<uint64_t>(static_cast<uint16_t>(y)) << 48)
+                                    ^ (static_cast<uint64_t>(static_cast<uint16_t>(z)) << 24) ^ static_cast<uint16_t>(x))); // "PIECE"
+}
+
+// Shape at position slot of the queue of upcoming pieces
+inline uint64_t queueKey(int slot, int shape) {
+    return mix(0x5155455545ull ^ mix(static_cast<uint64_t>(slot) * 16 + shape)); // "QUEUE"
+}
+
+}
+
+#endif
@@ -1,7 +1,20 @@
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
 #include "Game.h"
+#include "InputQueue.h"
+#include "LatencyTracker.h"
+#include "GameEvents.h"
+#include "Metrics.h"
+#include "FrameArena.h"
+#include "Versus.h"
+#include "NetLink.h"
+#include "PlacementBot.h"
+#include "TrainingData.h"
+#include <cstdio>
+#include <thread>
 
 void test_Block() {
-    Block block(glm::vec3(1, 2, 3), glm::vec3(1, 0, 0));
+    Block block(glm::vec3(1, 2, 3), 1);
     assert(block.getPosition().x == 1 && block.getPosition().y == 2 && block.getPosition().z == 3);
     block.setPosition(glm::vec3(5, 5, 5));
     assert(block.getPosition().x == 5 && block.getPosition().y == 5 && block.getPosition().z == 5);
@@ -60,4 +73,657 @@ void test_Game() {
 
     game.update(1.0f);
     assert(game.getIsRunning() == true);
-}
\ No newline at end of file
+}
+
+void test_GameGravity() {
+    // Same fall whether the time arrives in many small updates or in one
+    Game small(4, 16, 4, 7), large(4, 16, 4, 7);
+    small.setGravity(0.25f);
+    large.setGravity(0.25f);
+    float startY = small.getCurrentTetromino().getBlocks()[0].getPosition().y;
+    for (int i = 0; i < 16; ++i) {
+        small.update(1.0f / 64);
+    }
+    large.update(0.25f);
+    assert(small.getCurrentTetromino().getBlocks()[0].getPosition().y == startY - 3);
+    assert(large.getCurrentTetromino().getBlocks()[0].getPosition().y == startY - 3);
+
+    // 20G lands in one update, then the piece waits for the lock delay
+    Game game(4, 16, 4, 7);
+    game.setGravity(20.0f);
+    GameEventReader reader;
+    game.update(1.0f / 60);
+    assert(game.getGrid().dropDistance(game.getCurrentTetromino()) == 0);
+    game.update(0.25f);
+    GameEvent event;
+    bool locked = false;
+    while (reader.poll(game.getEvents(), event)) {
+        locked = locked || event.type == GameEventType::PieceLocked;
+    }
+    assert(!locked);
+    game.update(0.25f);
+    while (reader.poll(game.getEvents(), event)) {
+        locked = locked || event.type == GameEventType::PieceLocked;
+    }
+    assert(locked);
+}
+
+void test_FrameArena() {
+    FrameArena arena(64);
+    double* values = arena.allocateArray<double>(2);
+    assert(values && reinterpret_cast<uintptr_t>(values) % alignof(double) == 0);
+    const char* text = arena.format("Score %d", 42);
+    assert(std::string(text) == "Score 42");
+    assert(arena.allocate(64) == nullptr && arena.getFailedAllocations() == 1);
+
+    // Everything is released at once, the high-water mark stays
+    size_t used = arena.getUsed();
+    arena.reset();
+    assert(arena.getUsed() == 0 && arena.getHighWater() == used);
+    assert(arena.allocate(64) != nullptr);
+}
+
+void test_InputQueue() {
+    InputQueue queue;
+    assert(queue.isEmpty());
+    assert(queue.push({GLFW_KEY_A, GLFW_PRESS, 1.0}));
+    assert(queue.push({GLFW_KEY_A, GLFW_RELEASE, 2.0}));
+
+    InputEvent event;
+    assert(queue.pop(event) && event.key == GLFW_KEY_A && event.action == GLFW_PRESS);
+    assert(queue.pop(event) && event.action == GLFW_RELEASE && event.time == 2.0);
+    assert(!queue.pop(event));
+
+    // A full queue drops new events instead of overwriting unread ones
+    int pushed = 0;
+    while (queue.push({GLFW_KEY_S, GLFW_PRESS, 0.0})) {
+        pushed++;
+    }
+    assert(pushed == 256);
+    queue.clear();
+    assert(queue.isEmpty());
+}
+
+
+void test_LatencyHistogram() {
+    LatencyHistogram histogram;
+    assert(histogram.percentile(0.5) == 0.0);
+    for (int i = 1; i <= 100; ++i) {
+        histogram.add(i * 0.001); // 1 ms .. 100 ms
+    }
+    assert(histogram.getCount() == 100);
+    assert(histogram.percentile(0.50) > 0.049 && histogram.percentile(0.50) < 0.052);
+    assert(histogram.percentile(0.99) > 0.098);
+    histogram.reset();
+    assert(histogram.getCount() == 0);
+}
+
+
+void test_GameEventBuffer() {
+    GameEventBuffer buffer;
+    GameEventReader first, second;
+    GameEvent event;
+
+    buffer.publish(GameEventType::PieceSpawned, 3);
+    buffer.publish(GameEventType::LevelUp, 1);
+    assert(first.poll(buffer, event) && event.type == GameEventType::PieceSpawned && event.value == 3);
+    assert(first.poll(buffer, event) && event.type == GameEventType::LevelUp);
+    assert(!first.poll(buffer, event));
+
+    // Each reader has its own cursor
+    assert(second.poll(buffer, event) && event.type == GameEventType::PieceSpawned);
+
+    // A reader left far behind skips to the oldest available event
+    for (int i = 0; i < 1000; ++i) {
+        buffer.publish(GameEventType::PieceMoved);
+    }
+    int count = 0;
+    while (second.poll(buffer, event)) {
+        count++;
+    }
+    assert(count == 256);
+    assert(second.checkOverflow());
+    assert(!second.checkOverflow());
+}
+
+
+void test_Metrics() {
+    uint64_t before = metrics::registry().counter(metrics::Counter::RotationsRejected);
+    metrics::increment(metrics::Counter::RotationsRejected);
+    std::thread worker([] { metrics::increment(metrics::Counter::RotationsRejected, 2); });
+    worker.join();
+    assert(metrics::registry().counter(metrics::Counter::RotationsRejected) == before + 3);
+
+    metrics::observe(metrics::Histogram::UpdateSeconds, 0.0003);
+    std::string text = metrics::registry().format();
+    assert(text.find("# TYPE tetris_update_seconds histogram") != std::string::npos);
+    assert(text.find("tetris_line_clears_total{lines=\"4\"}") != std::string::npos);
+}
+
+
+// Moves the min x/z corner of the piece to (x, z) and its lowest blocks to layer y
+Tetromino placedAt(Tetromino t, int x, int y, int z) {
+    glm::vec3 minPos = t.getBlocks()[0].getPosition();
+    for (const auto& block : t.getBlocks()) {
+        glm::vec3 pos = block.getPosition();
+        minPos = glm::vec3(std::min(minPos.x, pos.x), std::min(minPos.y, pos.y), std::min(minPos.z, pos.z));
+    }
+    t.move(glm::vec3(x - minPos.x, y - minPos.y, z - minPos.z));
+    return t;
+}
+
+void test_GridBatchQueries() {
+    int width = 7;
+    int height = 10;
+    int depth = 5;
+    Grid grid(width, height, depth);
+    for (int i = 0; i < 12; ++i) {
+        Tetromino t = placedAt(Tetromino(glm::vec3(0, 0, 0), i % 7), (i * 3) % width, 0, (i * 2) % depth);
+        while (!grid.checkCollision(t)) {
+            t.move(glm::vec3(0, -1, 0));
+        }
+        t.move(glm::vec3(0, 1, 0));
+        if (!grid.checkCollision(t)) {
+            grid.placeTetromino(t);
+        }
+    }
+
+    for (int shape = 0; shape < 7; ++shape) {
+        Tetromino piece(glm::vec3(0, 0, 0), shape);
+        std::vector<uint64_t> fits(depth);
+        std::vector<int> landing(width * depth);
+        grid.queryLandingLayers(piece, height - 3, landing.data());
+        for (int y = 0; y < height; ++y) {
+            grid.queryFits(piece, y, fits.data());
+            for (int z = 0; z < depth; ++z) {
+                for (int x = 0; x < width; ++x) {
+                    bool fit = (fits[z] >> x) & 1;
+                    assert(fit == !grid.checkCollision(placedAt(piece, x, y, z)));
+                }
+            }
+        }
+        for (int z = 0; z < depth; ++z) {
+            for (int x = 0; x < width; ++x) {
+                Tetromino t = placedAt(piece, x, height - 3, z);
+                int expected = -1;
+                if (!grid.checkCollision(t)) {
+                    expected = height - 3;
+                    while (expected > 0 && !grid.checkCollision(placedAt(piece, x, expected - 1, z))) {
+                        expected--;
+                    }
+                }
+                assert(landing[z * width + x] == expected);
+            }
+        }
+    }
+}
+
+// Past the 64 columns of a row mask, in dense and sparse storage: queryFits spans several words per z row
+void test_GridWideDense() {
+    int width = 65;
+    int height = 8;
+    int depth = 3;
+    for (Grid::Storage storage : { Grid::Storage::Dense, Grid::Storage::Sparse }) {
+        Grid grid(width, height, depth, storage);
+        assert(grid.isSparse() == (storage == Grid::Storage::Sparse) && grid.getFitWords() == 2);
+        grid.placeTetromino(placedAt(Tetromino(glm::vec3(0, 0, 0), 3), 63, 0, 0)); // O piece on columns 63 and 64
+        grid.placeTetromino(placedAt(Tetromino(glm::vec3(0, 0, 0), 0), 2, 0, 1));
+        grid.placeTetromino(placedAt(Tetromino(glm::vec3(0, 0, 0), 1), 61, 0, 2));
+
+        for (int shape = 0; shape < 7; ++shape) {
+            Tetromino piece(glm::vec3(0, 0, 0), shape);
+            std::vector<uint64_t> fits(depth * 2);
+            for (int y = 0; y < height; ++y) {
+                grid.queryFits(piece, y, fits.data());
+                for (int z = 0; z < depth; ++z) {
+                    for (int x = 0; x < width; ++x) {
+                        bool fit = (fits[z * 2 + x / 64] >> (x % 64)) & 1;
+                        assert(fit == !grid.checkCollision(placedAt(piece, x, y, z)));
+                    }
+                }
+            }
+            std::vector<int> landing(width * depth);
+            grid.queryLandingLayers(piece, height - 3, landing.data());
+            for (int z = 0; z < depth; ++z) {
+                for (int x = 0; x < width; ++x) {
+                    int expected = -1;
+                    if (!grid.checkCollision(placedAt(piece, x, height - 3, z))) {
+                        expected = height - 3;
+                        while (expected > 0 && !grid.checkCollision(placedAt(piece, x, expected - 1, z))) {
+                            expected--;
+                        }
+                    }
+                    assert(landing[z * width + x] == expected);
+                }
+            }
+        }
+    }
+}
+
+void test_GridColorPlane() {
+    Grid grid(4, 6, 1);
+    grid.placeTetromino(placedAt(Tetromino(glm::vec3(0, 0, 0), 0, 2), 0, 0, 0)); // Fills layer 0
+    grid.placeTetromino(placedAt(Tetromino(glm::vec3(0, 0, 0), 3, 5), 1, 1, 0)); // O piece on layers 1 and 2
+    assert(grid.getCellColorIndex(0, 0, 0) == 2);
+    assert(grid.getCellColorIndex(1, 2, 0) == 5);
+
+    std::array<int, 4> cleared;
+    assert(grid.clearLines(&cleared) == 1 && cleared[0] == 0);
+    // Colours move down together with occupancy
+    assert(grid.isCellOccupied(1, 0, 0) && grid.getCellColorIndex(1, 0, 0) == 5);
+    assert(grid.getCellColorIndex(2, 1, 0) == 5);
+    assert(!grid.isCellOccupied(0, 0, 0) && grid.getCellColorIndex(0, 0, 0) == palette::EMPTY);
+    assert(!grid.isCellOccupied(1, 2, 0));
+}
+
+void test_GridKernelDispatch() {
+    Grid sized(6, 20, 6);
+    Grid generic(7, 20, 6);
+    assert(std::string(sized.getKernelName()) == "sized");
+    assert(std::string(generic.getKernelName()) == "generic");
+
+    for (int i = 0; i < 20; ++i) {
+        Tetromino t = placedAt(Tetromino(glm::vec3(0, 0, 0), i % 7, 1 + i % 5), (i * 5) % 5, 17, (i * 3) % 5);
+        while (!sized.checkCollision(t)) {
+            t.move(glm::vec3(0, -1, 0));
+        }
+        t.move(glm::vec3(0, 1, 0));
+        if (!sized.checkCollision(t)) {
+            sized.placeTetromino(t);
+        }
+    }
+
+    // Same layer removal through both kernel sets
+    BoardView board = sized.getBoardView();
+    const GridKernelTable& fast = selectGridKernels(6, 20, 6);
+    const GridKernelTable& slow = gridKernelTable<0, 0, 0>();
+    std::vector<uint8_t> fastColors(board.colors, board.colors + 6 * 20 * 6), slowColors = fastColors;
+    std::vector<uint64_t> fastRows(board.rowMasks, board.rowMasks + 20 * 6), slowRows = fastRows;
+    fast.removeLayer(board, fastColors.data(), fastRows.data(), 1);
+    slow.removeLayer(board, slowColors.data(), slowRows.data(), 1);
+    assert(fastColors == slowColors && fastRows == slowRows);
+}
+
+void test_SparseGrid() {
+    // Same drops on both storages, on a size that leaves partial 8x8 tiles
+    int width = 12, height = 20, depth = 10;
+    Grid dense(width, height, depth, Grid::Storage::Dense);
+    Grid sparse(width, height, depth, Grid::Storage::Sparse);
+    assert(!dense.isSparse() && sparse.isSparse());
+
+    // Layer 0 filled with I pieces, floating blocks above it, then the last piece clears the layer
+    for (int z = 0; z < depth; ++z) {
+        for (int x = 0; x < width; x += 4) {
+            Tetromino t = placedAt(Tetromino(glm::vec3(0, 0, 0), 0, 3), x, 0, z);
+            if (x == 8 && z == depth - 1) continue;
+            dense.placeTetromino(t);
+            sparse.placeTetromino(t);
+        }
+    }
+    for (int i = 0; i < 7; ++i) {
+        Tetromino t = placedAt(Tetromino(glm::vec3(0, 0, 0), i, 4), i, 6 + i, 9 - i);
+        dense.placeTetromino(t);
+        sparse.placeTetromino(t);
+    }
+    Tetromino last = placedAt(Tetromino(glm::vec3(0, 0, 0), 0, 3), 8, 0, depth - 1);
+    dense.placeTetromino(last);
+    sparse.placeTetromino(last);
+
+    int cleared = 0;
+    for (int i = 0; i < 400; ++i) {
+        Tetromino t = placedAt(Tetromino(glm::vec3(0, 0, 0), i % 7, 1 + i % 9), (i * 7) % width, height - 4, (i * 5) % depth);
+        assert(dense.checkCollision(t) == sparse.checkCollision(t));
+        if (dense.checkCollision(t)) continue;
+        assert(dense.dropDistance(t) == sparse.dropDistance(t));
+        t.move(glm::vec3(0, -dense.dropDistance(t), 0));
+        dense.placeTetromino(t);
+        sparse.placeTetromino(t);
+
+        std::array<int, 4> denseLayers, sparseLayers;
+        int lines = dense.clearLines(&denseLayers);
+        assert(sparse.clearLines(&sparseLayers) == lines);
+        cleared += lines;
+        for (int l = 0; l < std::min(lines, 4); ++l) {
+            assert(denseLayers[l] == sparseLayers[l]);
+        }
+    }
+    assert(cleared > 0);
+
+    int visited = 0;
+    sparse.forEachOccupiedCell([&](int x, int y, int z, uint8_t colorIndex) {
+        assert(dense.getCellColorIndex(x, y, z) == colorIndex);
+        visited++;
+    });
+    int occupied = 0;
+    for (int y = 0; y < height; ++y) {
+        for (int z = 0; z < depth; ++z) {
+            for (int x = 0; x < width; ++x) {
+                assert(dense.getCellColorIndex(x, y, z) == sparse.getCellColorIndex(x, y, z));
+                occupied += dense.isCellOccupied(x, y, z);
+            }
+        }
+    }
+    assert(visited == occupied);
+
+    std::vector<uint8_t> denseCells(width * height * depth), sparseCells(width * height * depth, 7);
+    dense.writeOccupancy(denseCells.data());
+    sparse.writeOccupancy(sparseCells.data());
+    assert(denseCells == sparseCells);
+    std::vector<uint8_t> denseHeights(width * depth), sparseHeights(width * depth, 7);
+    dense.writeColumnHeights(denseHeights.data());
+    sparse.writeColumnHeights(sparseHeights.data());
+    assert(denseHeights == sparseHeights);
+
+    std::vector<uint64_t> denseFits(depth), sparseFits(depth);
+    for (int shape = 0; shape < 7; ++shape) {
+        Tetromino piece(glm::vec3(0, 0, 0), shape);
+        for (int y = 0; y < height; ++y) {
+            dense.queryFits(piece, y, denseFits.data());
+            sparse.queryFits(piece, y, sparseFits.data());
+            assert(denseFits == sparseFits);
+        }
+    }
+
+    // A huge board only pays for the cells actually used
+    Grid huge(256, 1024, 256);
+    assert(huge.isSparse());
+    huge.placeTetromino(placedAt(Tetromino(glm::vec3(0, 0, 0), 0, 1), 100, 0, 100));
+    assert(huge.isCellOccupied(101, 0, 100) && !huge.isCellOccupied(101, 1, 100));
+    assert(huge.memoryBytes() < 64 * 1024);
+}
+
+void test_GridGarbage() {
+    for (Grid::Storage storage : { Grid::Storage::Dense, Grid::Storage::Sparse }) {
+        Grid grid(4, 8, 4, storage);
+        grid.placeTetromino(placedAt(Tetromino(glm::vec3(0, 0, 0), 3, 5), 0, 0, 0)); // O piece on layers 0 and 1
+        assert(grid.insertGarbageLayers(2, 1, 2, 14));
+        for (int z = 0; z < 4; ++z) {
+            for (int x = 0; x < 4; ++x) {
+                bool hole = x == 1 && z == 2;
+                assert(grid.isCellOccupied(x, 0, z) != hole && grid.isCellOccupied(x, 1, z) != hole);
+            }
+        }
+        // The stack moved up with its colours
+        assert(grid.getCellColorIndex(0, 2, 0) == 5 && grid.getCellColorIndex(0, 0, 0) == 14);
+        assert(grid.clearLines() == 0);
+
+        // A hole outside the board gives a full layer, which clears right away
+        assert(grid.insertGarbageLayers(1, -1, -1, 14));
+        std::array<int, 4> cleared;
+        assert(grid.clearLines(&cleared) == 1 && cleared[0] == 0);
+        assert(grid.getCellColorIndex(0, 2, 0) == 5 && !grid.isCellOccupied(1, 0, 2));
+
+        // Blocks pushed out of the top are reported
+        assert(!grid.insertGarbageLayers(7, 0, 0, 14));
+    }
+
+    Game game(4, 16, 4, 3);
+    game.addGarbage(3, 0, 0);
+    assert(game.getIsRunning() && game.getGrid().isCellOccupied(1, 2, 0) && !game.getGrid().isCellOccupied(0, 2, 0));
+    assert(!game.getGrid().checkCollision(game.getCurrentTetromino()));
+}
+
+// Random inputs, mostly idle
+uint8_t randomAction(std::mt19937& rng) {
+    int roll = std::uniform_int_distribution<>(0, 9)(rng);
+    return roll < 6 ? 0 : static_cast<uint8_t>(std::uniform_int_distribution<>(1, static_cast<int>(EnvAction::HardDrop))(rng));
+}
+
+void test_VersusRollback() {
+    // Restoring a snapshot and replaying the same inputs gives the same state
+    VersusMatch match(4, 12, 4, 5);
+    std::mt19937 rng(5);
+    for (int t = 0; t < 300; ++t) {
+        match.step({ randomAction(rng), randomAction(rng) });
+    }
+    VersusMatch::Snapshot start, first, second;
+    match.save(start);
+    std::mt19937 replayRng = rng;
+    for (int t = 0; t < 300; ++t) {
+        match.step({ randomAction(rng), randomAction(rng) });
+    }
+    match.save(first);
+    match.restore(start);
+    for (int t = 0; t < 300; ++t) {
+        match.step({ randomAction(replayRng), randomAction(replayRng) });
+    }
+    match.save(second);
+    assert(VersusMatch::checksum(first) == VersusMatch::checksum(second));
+    assert(VersusMatch::checksum(first) != VersusMatch::checksum(start));
+
+    // Two peers over a slow, lossy link, driven by a fake clock. Both must end up on the
+    // state of a match played with the actual inputs of both sides.
+    std::unique_ptr<RollbackSession> sessions[2] = {
+        std::unique_ptr<RollbackSession>(new RollbackSession(4, 12, 4, 9, 0)),
+        std::unique_ptr<RollbackSession>(new RollbackSession(4, 12, 4, 9, 1))
+    };
+    JitterInjector links[2] = { JitterInjector(0.05, 0.05, 0.2, 1), JitterInjector(0.05, 0.05, 0.2, 2) };
+    std::mt19937 bots[2] = { std::mt19937(1), std::mt19937(2) };
+    std::vector<uint8_t> played[2];
+    uint8_t pending[2] = { randomAction(bots[0]), randomAction(bots[1]) };
+    for (int frame = 0; frame < 1200; ++frame) {
+        double now = frame / 60.0;
+        for (int p = 0; p < 2; ++p) {
+            if (sessions[p]->advance(pending[p])) {
+                played[p].push_back(pending[p]);
+                pending[p] = randomAction(bots[p]);
+            }
+            InputPacket packet;
+            sessions[p]->makePacket(packet);
+            links[p].submit(&packet, packet.size(), now);
+            links[p].release(now, [&](const void* data, size_t size) { assert(sessions[1 - p]->receive(data, size)); });
+        }
+    }
+
+    for (int p = 0; p < 2; ++p) {
+        const RollbackStats& stats = sessions[p]->getStats();
+        assert(stats.rollbacks > 0 && stats.maxRollbackTicks < RollbackSession::WINDOW);
+        assert(stats.checksumsCompared > 0 && stats.desyncs == 0);
+    }
+    uint32_t checked = sessions[0]->getChecksumTick();
+    assert(checked > 0 && sessions[1]->getChecksumTick() == checked && sessions[0]->getChecksum() == sessions[1]->getChecksum());
+
+    VersusMatch reference(4, 12, 4, 9);
+    for (uint32_t t = 0; t < checked; ++t) {
+        reference.step({ played[0][t], played[1][t] });
+    }
+    VersusMatch::Snapshot expected;
+    reference.save(expected);
+    assert(VersusMatch::checksum(expected) == sessions[0]->getChecksum());
+
+    uint8_t junk[8] = {};
+    assert(!sessions[0]->receive(junk, sizeof(junk)));
+}
+
+void test_GridZobrist() {
+    for (Grid::Storage storage : { Grid::Storage::Dense, Grid::Storage::Sparse }) {
+        Grid a(4, 8, 4, storage), b(4, 8, 4, storage);
+        assert(a.getHash() == 0);
+
+        // Same cells in another order and other colours: same hash
+        Tetromino first = placedAt(Tetromino(glm::vec3(0, 0, 0), 3, 5), 0, 2, 0);
+        Tetromino second = placedAt(Tetromino(glm::vec3(0, 0, 0), 5, 6), 1, 4, 3);
+        uint64_t predicted = a.hashWith(first);
+        a.placeTetromino(first);
+        assert(a.getHash() == predicted && a.getHash() != 0);
+        a.placeTetromino(second);
+        b.placeTetromino(placedAt(Tetromino(glm::vec3(0, 0, 0), 5, 9), 1, 4, 3));
+        b.placeTetromino(placedAt(Tetromino(glm::vec3(0, 0, 0), 3, 2), 0, 2, 0));
+        assert(a.getHash() == b.getHash() && a.getHash() == a.computeHash());
+        assert(a.hashWith(first) == a.getHash()); // Already there, nothing changes
+
+        // The same cells one layer higher hash differently
+        Grid shifted(4, 8, 4, storage);
+        shifted.placeTetromino(placedAt(Tetromino(glm::vec3(0, 0, 0), 3, 5), 0, 3, 0));
+        shifted.placeTetromino(placedAt(Tetromino(glm::vec3(0, 0, 0), 5, 6), 1, 5, 3));
+        assert(shifted.getHash() != a.getHash());
+
+        // A full layer under them, once cleared, leaves the hash of the board without it
+        assert(shifted.insertGarbageLayers(1, -1, -1, 14));
+        assert(shifted.getHash() == shifted.computeHash());
+        assert(shifted.clearLines() == 1);
+        assert(shifted.getHash() == shifted.computeHash());
+        Grid expected(4, 8, 4, storage);
+        expected.placeTetromino(placedAt(Tetromino(glm::vec3(0, 0, 0), 3, 5), 0, 3, 0));
+        expected.placeTetromino(placedAt(Tetromino(glm::vec3(0, 0, 0), 5, 6), 1, 5, 3));
+        assert(shifted.getHash() == expected.getHash());
+    }
+
+    // Storage does not change the hash
+    Grid dense(12, 20, 10, Grid::Storage::Dense), sparse(12, 20, 10, Grid::Storage::Sparse);
+    for (int i = 0; i < 200; ++i) {
+        Tetromino t = placedAt(Tetromino(glm::vec3(0, 0, 0), i % 7, 1), (i * 7) % 9, 16, (i * 5) % 8);
+        if (dense.checkCollision(t)) continue;
+        t.move(glm::vec3(0, -dense.dropDistance(t), 0));
+        dense.placeTetromino(t);
+        sparse.placeTetromino(t);
+        dense.clearLines();
+        sparse.clearLines();
+        assert(dense.getHash() == sparse.getHash());
+    }
+    assert(dense.getHash() == dense.computeHash());
+
+    // Two games on the same seed and moves share their state hash
+    Game g1(4, 16, 4, 21), g2(4, 16, 4, 21);
+    assert(g1.getStateHash() == g2.getStateHash());
+    assert(g1.moveTetromino(glm::vec3(0, -1, 0)));
+    assert(g1.getStateHash() != g2.getStateHash());
+    g2.moveTetromino(glm::vec3(0, -1, 0));
+    assert(g1.getStateHash() == g2.getStateHash());
+}
+
+void test_EvalCache() {
+    const char* path = "test-evalcache.bin";
+    std::remove(path);
+    Evaluation evaluation, found;
+    evaluation.score = -3.25f;
+    evaluation.placement.rotationsZ = 1;
+    evaluation.placement.rotationsY = 3;
+    evaluation.placement.x = 2;
+    evaluation.placement.z = 1;
+    {
+        EvalCache cache(path, 4, 16, 4, 1, 200);
+        assert(cache.isOpen() && !cache.isWarm() && cache.getCapacity() == 256);
+        assert(!cache.lookup(42, found));
+        assert(cache.insert(42, evaluation));
+        assert(cache.insert(42 + 256, Evaluation())); // Same slot, probes to the next one
+        assert(cache.lookup(42, found) && found.score == -3.25f && found.placement.rotationsY == 3 && found.placement.x == 2);
+        assert(cache.lookup(42 + 256, found) && found.score == 0.0f);
+        assert(cache.getEntries() == 2);
+
+        // Concurrent inserts of distinct and shared positions all land once
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&cache, t] {
+                for (uint64_t key = 1000; key < 1012; ++key) {
+                    cache.insert(key, Evaluation());
+                    cache.insert(key * 100 + t, Evaluation());
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        assert(cache.getEntries() == 2 + 12 + 4 * 12);
+        assert(cache.lookup(1011, found) && cache.lookup(101103, found));
+    }
+
+    // Evaluations persist, until the heuristic changes
+    {
+        EvalCache cache(path, 4, 16, 4, 1, 256);
+        assert(cache.isWarm() && cache.lookup(42, found) && found.placement.rotationsZ == 1 && found.placement.z == 1);
+    }
+    {
+        EvalCache cache(path, 4, 16, 4, 2, 256);
+        assert(!cache.isWarm() && !cache.lookup(42, found) && cache.getEntries() == 0);
+    }
+
+    // A bot playing from the cache plays the same game as one searching every position
+    {
+        EvalCache cache(path, 4, 16, 4, PlacementBot::HEURISTIC_VERSION, 1024);
+        PlacementBot searching, filling(&cache), replaying(&cache);
+        Game a(4, 16, 4, 8), b(4, 16, 4, 8), c(4, 16, 4, 8);
+        for (int piece = 0; piece < 30; ++piece) {
+            searching.play(a);
+            filling.play(b);
+        }
+        for (int piece = 0; piece < 30; ++piece) {
+            replaying.play(c);
+        }
+        assert(a.getStateHash() == b.getStateHash() && b.getStateHash() == c.getStateHash());
+        assert(a.getTotalLinesCleared() == c.getTotalLinesCleared() && a.getScore() == c.getScore());
+        assert(replaying.getSearches() == 0 && replaying.getCacheHits() == filling.getSearches());
+    }
+    std::remove(path);
+}
+
+void test_TrainingData() {
+    // ZeroRun round trip, with runs of zeros at both ends
+    std::vector<uint8_t> raw = { 0, 0, 0, 5, 0, 7, 7, 0, 0, 0, 0, 9, 0, 0 }, encoded, decoded(raw.size());
+    trainingdata::encodeZeroRuns(raw.data(), raw.size(), encoded);
+    assert(encoded.size() < raw.size());
+    assert(trainingdata::decodeZeroRuns(encoded.data(), encoded.size(), decoded.data(), decoded.size()) && decoded == raw);
+    assert(!trainingdata::decodeZeroRuns(encoded.data(), encoded.size(), decoded.data(), decoded.size() - 1));
+
+    const char* path = "test-training.bin";
+    int totalPieces = 0, totalLines = 0;
+    std::vector<int> scores;
+    {
+        // Small chunks, so that games span several of them
+        TrainingExporter exporter(path, 4, 16, 4, 16);
+        assert(exporter.isOpen() && exporter.getBoardBytes() == 32);
+        TrainingRecorder recorder(exporter);
+        PlacementBot bot;
+        for (unsigned seed = 1; seed <= 3; ++seed) {
+            Game game(4, 16, 4, seed);
+            recorder.follow(game);
+            while (bot.play(game)) {
+                recorder.observe(game);
+                totalPieces++;
+            }
+            recorder.observe(game);
+            totalPieces++;
+            totalLines += game.getTotalLinesCleared();
+            scores.push_back(game.getScore());
+        }
+        recorder.finish();
+        exporter.finish();
+        assert(exporter.getRecords() == static_cast<uint64_t>(totalPieces));
+    }
+
+    TrainingReader reader(path);
+    assert(reader.isOpen() && reader.getWidth() == 4 && reader.getHeight() == 16 && reader.getDepth() == 4);
+    assert(reader.getRecordCount() == static_cast<uint64_t>(totalPieces) && reader.getChunkCount() > 1);
+    int lines = 0;
+    uint32_t lastGame = 0;
+    int previousLines = -1, previousX = 0, previousY = 0, previousZ = 0;
+    uint32_t previousOrientation = 0;
+    for (size_t c = 0; c < reader.getChunkCount(); ++c) {
+        TrainingReader::Chunk chunk;
+        assert(reader.readChunk(c, chunk));
+        for (uint32_t r = 0; r < chunk.records; ++r) {
+            const uint8_t* board = chunk.boards + static_cast<size_t>(r) * reader.getBoardBytes();
+            assert(chunk.games[r] == lastGame || chunk.games[r] == lastGame + 1);
+            assert(chunk.finalScores[r] == scores[chunk.games[r]] && chunk.shapes[r] < 7);
+            if (chunk.games[r] != lastGame || previousLines < 0) {
+                // A game starts on an empty board
+                for (uint32_t b = 0; b < reader.getBoardBytes(); ++b) assert(board[b] == 0);
+            } else if (previousLines == 0) {
+                // Without a clear, the piece locked by the previous record is on this board
+                for (int b = 0; b < 4; ++b) {
+                    int cell = (previousOrientation >> (8 * b)) & 0xff;
+                    assert(reader.isOccupied(board, previousX + (cell & 3), previousY + (cell >> 4), previousZ + ((cell >> 2) & 3)));
+                }
+            }
+            lastGame = chunk.games[r];
+            lines += chunk.lines[r];
+            previousLines = chunk.lines[r];
+            previousOrientation = chunk.orientations[r];
+            previousX = chunk.x[r];
+            previousY = chunk.y[r];
+            previousZ = chunk.z[r];
+        }
+    }
+    assert(lines == totalLines && lastGame == 2);
+    std::remove(path);
+}
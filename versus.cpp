@@ -0,0 +1,164 @@
+// Two-player versus match with rollback over UDP on the loopback interface.
+// Each peer only sends its inputs; the remote ones are predicted and a wrong
+// prediction is fixed by restoring a snapshot and simulating the ticks again.
+// Random bots play both sides and the peers compare state checksums all along.
+//
+// Build: g++ -O2 versus.cpp -o versus -pthread
+// Usage: ./versus [options]                                  both peers in this process
+//        ./versus --player P --port A --peer-port B [options] one peer, the other runs elsewhere
+//   --seconds S     play for S seconds (default 10)
+//   --seed S        match seed, the same on both peers (default 1)
+//   --latency MS    added one-way latency in milliseconds (default 0)
+//   --jitter MS     random extra latency, up to MS milliseconds (default 0)
+//   --loss P        probability of dropping a datagram (default 0)
+#include "src/Versus.h"
+#include "src/NetLink.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+
+const int WIDTH = 4, HEIGHT = 16, DEPTH = 4;
+const double FRAME_SECONDS = 1.0 / 60.0;
+
+// Presses a random key every few frames and hard drops from time to time
+class RandomBot {
+    private:
+        std::mt19937 rng;
+
+    public:
+        RandomBot(unsigned seed): rng(seed) {}
+
+        uint8_t next() {
+            int roll = std::uniform_int_distribution<>(0, 99)(rng);
+            if (roll < 85) return static_cast<uint8_t>(EnvAction::Idle);
+            if (roll < 88) return static_cast<uint8_t>(EnvAction::HardDrop);
+            return static_cast<uint8_t>(std::uniform_int_distribution<>(1, static_cast<int>(EnvAction::RotateZ))(rng));
+        }
+};
+
+struct Peer {
+    std::unique_ptr<RollbackSession> session;
+    UdpSocket socket;
+    JitterInjector injector;
+    RandomBot bot;
+    uint8_t pendingAction;
+    double maxFrameSeconds = 0.0;
+
+    Peer(unsigned seed, int player, double latency, double jitter, double loss)
+        : session(new RollbackSession(WIDTH, HEIGHT, DEPTH, seed, player)), injector(latency, jitter, loss, seed * 2 + player),
+          bot(seed * 2 + player), pendingAction(bot.next()) {}
+
+    // One frame: read the network, advance one tick, send the unacknowledged inputs
+    void frame(double now) {
+        auto start = std::chrono::steady_clock::now();
+        uint8_t datagram[sizeof(InputPacket)];
+        int size;
+        while ((size = socket.receive(datagram, sizeof(datagram))) >= 0) {
+            session->receive(datagram, size);
+        }
+        if (session->advance(pendingAction)) {
+            pendingAction = bot.next();
+        }
+        InputPacket packet;
+        session->makePacket(packet);
+        injector.submit(&packet, packet.size(), now);
+        injector.release(now, [this](const void* data, size_t size) { socket.send(data, size); });
+        maxFrameSeconds = std::max(maxFrameSeconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    void report() const {
+        const RollbackStats& stats = session->getStats();
+        const VersusMatch& match = session->getMatch();
+        int player = session->getLocalPlayer();
+        double resimulatedPerRollback = stats.rollbacks ? static_cast<double>(stats.resimulatedTicks) / stats.rollbacks : 0.0;
+        double microsecondsPerTick = stats.resimulatedTicks ? stats.resimulationSeconds * 1e6 / stats.resimulatedTicks : 0.0;
+        std::printf("[Versus] Player %d: %llu ticks, %d rounds, wins %d-%d\n", player, (unsigned long long)stats.ticks,
+                    match.getRound(), match.getWins(player), match.getWins(1 - player));
+        std::printf("[Versus]   %llu rollbacks (%.1f%% of ticks), %.1f ticks resimulated on average, %u at most\n",
+                    (unsigned long long)stats.rollbacks, stats.ticks ? 100.0 * stats.rollbacks / stats.ticks : 0.0,
+                    resimulatedPerRollback, stats.maxRollbackTicks);
+        std::printf("[Versus]   resimulation %.2f us per tick, worst frame %.3f ms of resimulation, %.3f ms in total (budget %.1f ms)\n",
+                    microsecondsPerTick, stats.maxResimulationSeconds * 1e3, maxFrameSeconds * 1e3, FRAME_SECONDS * 1e3);
+        std::printf("[Versus]   %llu stalled frames, %llu of %llu datagrams dropped, %llu checksums compared, %llu desyncs\n",
+                    (unsigned long long)stats.stalls, (unsigned long long)injector.getDropped(), (unsigned long long)injector.getSubmitted(),
+                    (unsigned long long)stats.checksumsCompared, (unsigned long long)stats.desyncs);
+    }
+};
+
+int main(int argc, char** argv) {
+    double seconds = 10.0, latency = 0.0, jitter = 0.0, loss = 0.0;
+    unsigned seed = 1;
+    int player = -1;
+    int port = 0, peerPort = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            latency = std::atof(argv[++i]) / 1000.0;
+        } else if (std::strcmp(argv[i], "--jitter") == 0 && i + 1 < argc) {
+            jitter = std::atof(argv[++i]) / 1000.0;
+        } else if (std::strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+            loss = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--player") == 0 && i + 1 < argc) {
+            player = std::atoi(argv[++i]) ? 1 : 0;
+        } else if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--peer-port") == 0 && i + 1 < argc) {
+            peerPort = std::atoi(argv[++i]);
+        }
+    }
+
+    std::vector<std::unique_ptr<Peer>> peers;
+    if (player >= 0) {
+        if (port <= 0 || peerPort <= 0) {
+            std::cerr << "[Error] --player needs --port and --peer-port" << std::endl;
+            return 2;
+        }
+        peers.emplace_back(new Peer(seed, player, latency, jitter, loss));
+        if (!peers[0]->socket.open(static_cast<uint16_t>(port))) return 2;
+        peers[0]->socket.setPeer(static_cast<uint16_t>(peerPort));
+    } else {
+        for (int p = 0; p < 2; ++p) {
+            peers.emplace_back(new Peer(seed, p, latency, jitter, loss));
+            if (!peers[p]->socket.open(0)) return 2;
+        }
+        peers[0]->socket.setPeer(peers[1]->socket.getLocalPort());
+        peers[1]->socket.setPeer(peers[0]->socket.getLocalPort());
+    }
+
+    // Fixed 60 Hz frames, as the renderer would run them
+    auto start = std::chrono::steady_clock::now();
+    auto nextFrame = start;
+    for (int frame = 0; frame < seconds / FRAME_SECONDS; ++frame) {
+        double now = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (std::unique_ptr<Peer>& peer : peers) {
+            peer->frame(now);
+        }
+        nextFrame += std::chrono::microseconds(static_cast<int>(FRAME_SECONDS * 1e6));
+        std::this_thread::sleep_until(nextFrame);
+    }
+
+    uint64_t desyncs = 0;
+    for (const std::unique_ptr<Peer>& peer : peers) {
+        peer->report();
+        desyncs += peer->session->getStats().desyncs;
+    }
+    if (peers.size() == 2) {
+        const RollbackSession& a = *peers[0]->session;
+        const RollbackSession& b = *peers[1]->session;
+        uint32_t common = std::min(a.getChecksumTick(), b.getChecksumTick());
+        std::printf("[Versus] Latest checksums: tick %u %016llx, tick %u %016llx\n", a.getChecksumTick(), (unsigned long long)a.getChecksum(),
+                    b.getChecksumTick(), (unsigned long long)b.getChecksum());
+        if (common == 0) {
+            std::cerr << "[Error] No confirmed state to compare" << std::endl;
+            return 1;
+        }
+    }
+    return desyncs == 0 ? 0 : 1;
+}